@@ -0,0 +1,364 @@
+﻿#include <Siv3D.hpp> // OpenSiv3D v0.3.0
+#include <iostream>
+
+//開いているエディタやゲームとつながらないように、既定とは別のポートを使う
+#define PMT_PORT_NUMBER 52824
+#include "ParamEditorCore.hpp"
+
+//ParamEditorCore.hpp だけを使うベンチマーク(Editor.cpp とは別の実行ファイルとしてビルドする)
+//結果は 1 行 1 件の JSON として標準出力と benchmark.jsonl に書き出す
+//ParameterEditor ディレクトリは一時ディレクトリの下に作られる
+//Siv3D のアプリケーションとしてビルドするのでウィンドウは開くが、何も描かずに計測が終わると閉じる
+//(OpenSiv3D v0.3 は Windows 版だけなので、Editor.cpp と同じく Windows の Siv3D プロジェクトに追加してビルドする)
+
+using namespace pmt;
+using namespace pmt::detailImpl;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	//1 件分の計測結果(samples は 1 回の操作あたりのナノ秒)
+	struct BenchmarkResult
+	{
+		String name;
+		size_t entries = 0;
+		Array<double> samples;
+		double totalSeconds = 0.0;
+		size_t operations = 0;
+		//時間内に終わらなかった回数(標本には含めない)
+		size_t timeouts = 0;
+		//計測できなかった理由(空なら成功)
+		String error;
+	};
+
+	double Percentile(const Array<double>& sortedSamples, double p)
+	{
+		if (sortedSamples.empty())
+		{
+			return 0.0;
+		}
+
+		const size_t index = static_cast<size_t>(p * (sortedSamples.size() - 1) + 0.5);
+		return sortedSamples[index];
+	}
+
+	String ToJSON(const BenchmarkResult& result)
+	{
+		if (!result.error.isEmpty())
+		{
+			return U"{{\"benchmark\":\"{}\",\"entries\":{},\"error\":\"{}\"}}"_fmt(result.name, result.entries, result.error);
+		}
+
+		Array<double> sorted = result.samples;
+		std::sort(sorted.begin(), sorted.end());
+
+		const double opsPerSecond = result.totalSeconds <= 0.0 ? 0.0 : result.operations / result.totalSeconds;
+		return U"{{\"benchmark\":\"{}\",\"entries\":{},\"unit\":\"ns\",\"samples\":{},\"ops_per_sec\":{},\"p50\":{},\"p99\":{},\"timeouts\":{}}}"_fmt(
+			result.name, result.entries, sorted.size(), ToString(opsPerSecond, 1), ToString(Percentile(sorted, 0.5), 1), ToString(Percentile(sorted, 0.99), 1), result.timeouts);
+	}
+
+	//batchSize 回の f() を batches 回計測し、1 回あたりの時間を標本にする
+	template <class Function>
+	BenchmarkResult Measure(const String& name, size_t entries, size_t batches, size_t batchSize, Function f)
+	{
+		BenchmarkResult result;
+		result.name = name;
+		result.entries = entries;
+
+		for (size_t batch = 0; batch < batches; ++batch)
+		{
+			const auto begin = Clock::now();
+			for (size_t n = 0; n < batchSize; ++n)
+			{
+				f();
+			}
+			const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+			result.samples.push_back(seconds * 1e9 / batchSize);
+			result.totalSeconds += seconds;
+			result.operations += batchSize;
+		}
+
+		return result;
+	}
+
+	ParameterData MakeParameterData(size_t entries)
+	{
+		ParameterData data;
+		for (size_t n = 0; n < entries; ++n)
+		{
+			data.colors[U"Benchmark.Color{}"_fmt(n)] = HSV(n * 7.0, 0.5, 0.75);
+			data.floats[U"Benchmark.Float{}"_fmt(n)] = n * 0.5;
+		}
+		return data;
+	}
+
+	//pmt::GetColor の 1 回あたりのコスト(ハンドルと名前の両方)
+	void MeasureLookup(Array<BenchmarkResult>& results)
+	{
+		const ColorParam param = Register(U"Benchmark.Lookup");
+
+		//最適化で呼び出しが消えないように結果を書き込む先
+		volatile uint32 sink = 0;
+
+		results.push_back(Measure(U"get_color_handle", 1, 100, 100000, [&]
+		{
+			sink = GetColor(param).r;
+		}));
+
+		results.push_back(Measure(U"get_color_name", 1, 100, 10000, [&]
+		{
+			sink = GetColor(U"Benchmark.Lookup").r;
+		}));
+
+		//インスタンス描画の色の転送のように、多数のハンドルをまとめて読む場合(1 回で entries 色)
+		{
+			Array<ColorParam> params;
+			for (size_t n = 0; n < 1000; ++n)
+			{
+				params.push_back(Register(U"Benchmark.Bulk{}"_fmt(n)));
+			}
+			Update();
+
+			Array<Color> colors(params.size());
+			Array<ColorF> colorFs(params.size());
+			results.push_back(Measure(U"get_colors_bulk", params.size(), 100, 1, [&]
+			{
+				GetColors(params.data(), params.size(), colors.data());
+			}));
+			results.push_back(Measure(U"get_colorfs_bulk", params.size(), 100, 1, [&]
+			{
+				GetColors(params.data(), params.size(), colorFs.data());
+			}));
+		}
+
+		//ワーカースレッドから同時に読んだ場合(スレッド数に比例して伸びるか)
+		for (const size_t threadCount : { 2, 4, 8 })
+		{
+			BenchmarkResult result;
+			result.name = U"get_color_handle_threads{}"_fmt(threadCount);
+			result.entries = 1;
+
+			for (size_t batch = 0; batch < 20; ++batch)
+			{
+				constexpr size_t batchSize = 100000;
+
+				const auto begin = Clock::now();
+				std::vector<std::thread> threads;
+				for (size_t t = 0; t < threadCount; ++t)
+				{
+					threads.emplace_back([&]
+					{
+						volatile uint32 threadSink = 0;
+						for (size_t n = 0; n < batchSize; ++n)
+						{
+							threadSink = GetColor(param).r;
+						}
+					});
+				}
+				for (auto& thread : threads)
+				{
+					thread.join();
+				}
+				const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+				result.samples.push_back(seconds * 1e9 / batchSize);
+				result.totalSeconds += seconds;
+				result.operations += batchSize * threadCount;
+			}
+
+			results.push_back(std::move(result));
+		}
+	}
+
+	//pmt::Animate でアニメーションする色をまとめて評価するコストと、評価済みの色を読むコスト
+	void MeasureAnimation(Array<BenchmarkResult>& results)
+	{
+		for (const size_t entries : { 100, 1000, 10000 })
+		{
+			Array<AnimatedColorParam> params;
+			for (size_t n = 0; n < entries; ++n)
+			{
+				params.push_back(Register<ColorAnimation>(U"Benchmark.Animation{}"_fmt(n)));
+			}
+
+			//登録した分を値の複製に入れる
+			Update();
+
+			double time = 0.0;
+			results.push_back(Measure(U"animate_batch", entries, 100, 10, [&]
+			{
+				time += 1.0 / 60.0;
+				Animate(time);
+			}));
+		}
+
+		const AnimatedColorParam param = Register<ColorAnimation>(U"Benchmark.Animation0");
+		volatile uint32 sink = 0;
+		results.push_back(Measure(U"get_animated_color_handle", 1, 100, 100000, [&]
+		{
+			sink = GetAnimatedColor(param).r;
+		}));
+	}
+
+	//階層付きの名前の前方一致の列挙(全体の数ではなく部分木の大きさに比例するか)
+	void MeasureTree(Array<BenchmarkResult>& results)
+	{
+		for (const size_t entries : { 1000, 10000 })
+		{
+			for (size_t n = 0; n < entries; ++n)
+			{
+				Register(U"Benchmark/Tree{}/Group{}/Param{}"_fmt(entries, n % 100, n), 0.0);
+			}
+
+			const String prefix = U"Benchmark/Tree{}/Group7"_fmt(entries);
+			volatile size_t sink = 0;
+			results.push_back(Measure(U"list_parameters_prefix", entries, 100, 100, [&]
+			{
+				sink = ListParameters(prefix).size();
+			}));
+		}
+	}
+
+	//ParameterData の直列化と復元(セーブデータ・ファイル経由の通信で使う形式)
+	void MeasureSerialization(Array<BenchmarkResult>& results)
+	{
+		for (const size_t entries : { 10, 1000, 10000 })
+		{
+			const ParameterData data = MakeParameterData(entries);
+			const size_t batches = entries <= 1000 ? 200 : 20;
+
+			ByteArray bytes;
+			results.push_back(Measure(U"serialize_parameter_data", entries, batches, 1, [&]
+			{
+				Serializer<MemoryWriter> serializer;
+				serializer(data);
+				const auto& writer = serializer.getWriter();
+				bytes = ByteArray(writer.data(), static_cast<size_t>(writer.size()));
+			}));
+
+			results.push_back(Measure(U"deserialize_parameter_data", entries, batches, 1, [&]
+			{
+				Deserializer<ByteArray> deserializer(bytes.data(), static_cast<size_t>(bytes.size()));
+				ParameterData restored;
+				deserializer(restored);
+			}));
+
+			//セッション開始直後(名前と ID の対応を含む)の差分メッセージ
+			results.push_back(Measure(U"encode_first_message", entries, batches, 1, [&]
+			{
+				ParameterEncoder encoder;
+				const Array<Byte> frame = EncodeFrame(encoder.encode(data));
+			}));
+		}
+	}
+
+	//エディタ役の EditorServer とゲーム役の pmt:: を同じプロセスで動かし、
+	//エディタで変えた値がゲーム側の pmt::GetFloat で見えるまでの時間を測る
+	void MeasureSyncLatency(Array<BenchmarkResult>& results)
+	{
+		const String name = U"Benchmark.Latency";
+
+		EditorServer editor;
+		const FloatParam param = Register(name, 0.0);
+
+		//両方のワーカーが Running になり、登録した名前がエディタに届くまで待つ
+		const auto connectDeadline = Clock::now() + std::chrono::seconds(10);
+		bool connected = false;
+		while (!connected && Clock::now() < connectDeadline)
+		{
+			Update();
+			editor.notify();
+
+			Optional<SaveSnapshot> loadedSnapshot;
+			ParameterData received;
+			editor.take(loadedSnapshot, received);
+			connected = received.floats.find(name) != received.floats.end();
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		//失敗も結果の 1 行として benchmark.jsonl に残す
+		if (!connected)
+		{
+			BenchmarkResult result;
+			result.name = U"sync_round_trip";
+			result.entries = 1;
+			result.error = U"handshake timed out";
+			results.push_back(std::move(result));
+			return;
+		}
+
+		//既定の起床間隔(8 ms)と、起床間隔を詰めた場合
+		for (const double tickRate : { 125.0, 1000.0 })
+		{
+			SetTickRate(tickRate);
+			editor.setTickRate(tickRate);
+
+			BenchmarkResult result;
+			result.name = U"sync_round_trip_tick{}"_fmt(static_cast<int32>(tickRate));
+			result.entries = 1;
+
+			for (int32 n = 1; n <= 200; ++n)
+			{
+				const double value = tickRate * 1000.0 + n;
+
+				ParameterData data;
+				data.floats[name] = value;
+
+				const auto begin = Clock::now();
+				editor.send(data);
+				editor.notify();
+
+				const auto deadline = begin + std::chrono::seconds(1);
+				while (GetValue(param) != value && Clock::now() < deadline)
+				{
+					Update();
+					editor.notify();
+					std::this_thread::yield();
+				}
+				const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+				if (GetValue(param) != value)
+				{
+					++result.timeouts;
+					continue;
+				}
+
+				result.samples.push_back(seconds * 1e9);
+				result.totalSeconds += seconds;
+				++result.operations;
+			}
+
+			results.push_back(std::move(result));
+		}
+	}
+}
+
+void Main()
+{
+	Console.open();
+
+	const FilePath workingDirectory = FileSystem::TempDirectoryPath() + U"SivParamEditorBenchmark/";
+	FileSystem::CreateDirectories(workingDirectory);
+	FileSystem::ChangeCurrentDirectory(workingDirectory);
+
+	//前回の実行で保存された値を読み込まないように消しておく
+	FileSystem::Remove(workingDirectory + U"ParameterEditor/");
+
+	Array<BenchmarkResult> results;
+	MeasureLookup(results);
+	MeasureAnimation(results);
+	MeasureTree(results);
+	MeasureSerialization(results);
+	MeasureSyncLatency(results);
+
+	TextWriter writer(workingDirectory + U"benchmark.jsonl");
+	for (const auto& result : results)
+	{
+		const String line = ToJSON(result);
+		writer.writeln(line);
+		std::cout << line.narrow() << std::endl;
+	}
+}
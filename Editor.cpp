@@ -1,253 +1,279 @@
 ﻿#include <Siv3D.hpp> // OpenSiv3D v0.3.0
+#include <deque>
 #include "ParamEditor.hpp"
 
 using namespace pmt;
 using namespace pmt::detailImpl;
 
-class ParameterReceiver
+//ゲームから返ってきた計測結果(エディタで変更してからゲームで読まれるまで)をヒストグラムで表示する
+//段階ごとの中央値も並べ、エディタの送信待ち・通信・ゲームの pmt::Update 待ち・読まれるまでのどこで時間がかかっているかを見分ける
+class LatencyHistogram
 {
 public:
-	static void Update()
+	void add(const Array<LatencyTrace>& traces)
 	{
-		auto& i = instance();
-		i.reportUpdate = true;
-
-		for (const auto& keyVal : i.state.receivedBuffer.colors)
+		bool added = false;
+		for (const auto& trace : traces)
 		{
-			if (!i.state.editor.exists(keyVal.first))
+			if (trace.editedAt == 0 || trace.readAt == 0)
+			{
+				continue;
+			}
+
+			samples.push_back(trace);
+			if (MaxSamples < samples.size())
 			{
-				i.state.editor.add(keyVal.first, keyVal.second);
+				samples.pop_front();
 			}
+			added = true;
 		}
 
-		i.state.editor.update();
-		AddData(i.state.editor.getUpdates());
+		//集計は標本が増えた時だけやり直す(描画は毎フレーム)
+		if (added)
+		{
+			refresh();
+		}
 	}
 
-	static ParameterData& ReceivedBuffer()
+	void draw()const
 	{
-		auto& i = instance();
-		return i.state.receivedBuffer;
+		if (samples.empty())
+		{
+			return;
+		}
+
+		const RectF scope(Window::Width() - 340, Window::Height() - 230, 330, 220);
+		scope.draw(ColorF(0.0, 0.7));
+
+		const RectF graph(scope.pos + Vec2(10, 30), scope.w - 20, 100);
+		const double barWidth = graph.w / BinCount;
+		for (size_t n = 0; n < BinCount; ++n)
+		{
+			const double barHeight = graph.h * bins[n] / maxCount;
+			RectF(graph.x + barWidth * n, graph.y + graph.h - barHeight, barWidth - 1, barHeight).draw(Palette::Orange);
+		}
+		graph.drawFrame(1.0, Palette::Gray);
+
+		font(U"編集→ゲームで読まれるまで (n={})"_fmt(samples.size())).draw(scope.pos + Vec2(10, 5));
+		font(U"0 ms").draw(graph.bl());
+		font(U"{} ms"_fmt(ToString(Max(p99, 1.0), 1))).draw(Arg::topRight = graph.br());
+
+		const double x = scope.x + 10;
+		double y = graph.y + graph.h + 20;
+		font(U"p50 {} ms / p99 {} ms"_fmt(ToString(p50, 1), ToString(p99, 1))).draw(x, y);
+		y += 20;
+		font(U"エディタの送信待ち {} ms / 通信 {} ms"_fmt(ToString(stageMedians[0], 1), ToString(stageMedians[1], 1))).draw(x, y);
+		y += 20;
+		font(U"pmt::Update 待ち {} ms / 読まれるまで {} ms"_fmt(ToString(stageMedians[2], 1), ToString(stageMedians[3], 1))).draw(x, y);
 	}
 
-	static void AddData(const std::unordered_map<String, Color>& colors)
+private:
+	static double ToMillisec(int64 microsec)
 	{
-		auto& i = instance();
-		for (const auto& color : colors)
+		return microsec / 1000.0;
+	}
+
+	void refresh()
+	{
+		Array<double> totals;
+		for (const auto& trace : samples)
 		{
-			i.sendBuffer.colors[color.first] = color.second;
+			totals.push_back(ToMillisec(trace.readAt - trace.editedAt));
 		}
+		std::sort(totals.begin(), totals.end());
+
+		p50 = totals[totals.size() / 2];
+		p99 = totals[(totals.size() - 1) * 99 / 100];
+
+		//p99 までを等分し、それより遅いものは最後の棒に入れる
+		const double binWidth = Max(p99, 1.0) / BinCount;
+		bins.fill(0);
+		for (const double total : totals)
+		{
+			bins[Min(static_cast<size_t>(total / binWidth), BinCount - 1)] += 1;
+		}
+		maxCount = *std::max_element(bins.begin(), bins.end());
+
+		stageMedians = {
+			median([](const LatencyTrace& t) { return t.sentAt - t.editedAt; }),
+			median([](const LatencyTrace& t) { return t.receivedAt - t.sentAt; }),
+			median([](const LatencyTrace& t) { return t.appliedAt - t.receivedAt; }),
+			median([](const LatencyTrace& t) { return t.readAt - t.appliedAt; }) };
 	}
 
-private:
-	static void ReceiveNewColors()
+	template <class Function>
+	double median(Function stage)const
+	{
+		Array<double> values;
+		for (const auto& trace : samples)
+		{
+			values.push_back(ToMillisec(stage(trace)));
+		}
+		const auto middle = values.begin() + values.size() / 2;
+		std::nth_element(values.begin(), middle, values.end());
+		return *middle;
+	}
+
+	static constexpr size_t MaxSamples = 512;
+	static constexpr size_t BinCount = 32;
+
+	std::deque<LatencyTrace> samples;
+	//samples から refresh() で求めたもの(時間は ms, stageMedians は送信待ち・通信・pmt::Update 待ち・読まれるまで)
+	double p50 = 0.0;
+	double p99 = 0.0;
+	std::array<size_t, BinCount> bins{};
+	size_t maxCount = 0;
+	std::array<double, 4> stageMedians{};
+	Font font = Font(12);
+};
+
+class ParameterReceiver
+{
+public:
+	static void Update()
 	{
 		auto& i = instance();
-		i.server.startAccept(PortNumber);
-		bool connected = false;
+		i.server.notify();
 
-		while (!i.terminationRequest)
+		//ワーカーが受け取ったものを反映する(state に触るのはメインスレッドだけ)
 		{
-			if (!i.reportUpdate)
-			{
-				continue;
-			}
-			i.reportUpdate = false;
+			Optional<SaveSnapshot> loadedSnapshot;
+			ParameterData receivedValues;
+			i.server.take(loadedSnapshot, receivedValues);
 
-			switch (i.phase)
-			{
-			case ParameterReceiver::Error:
+			if (loadedSnapshot)
 			{
-				Window::SetTitle(U"初期化に失敗");
-				break;
+				i.state.receivedBuffer = std::move(loadedSnapshot.value().receivedBuffer);
+				i.journaledValues = loadedSnapshot.value().editor.values;
+				i.state.editor.restore(loadedSnapshot.value().editor);
+				i.journaledGroupsVersion = i.state.editor.getGroupsVersion();
+				i.journaledPositionsVersion = i.state.editor.getPositionsVersion();
 			}
-			case ParameterReceiver::Ready:
-			{
-				if (i.server.hasSession())
-				{
-					connected = true;
-
-					//Window::SetTitle(U"TCPServer: 接続完了！");
-
-					Array<Byte> byteArray(4 * 256);
-					if (!i.server.read(byteArray.data(), 4 * 256, unspecified))
-					{
-						break;
-					}
-
-					Deserializer<ByteArray> filePathDeserializer(byteArray);
-
-					std::array<char32_t, 256> filePath{};
-					ParameterData receivedData;
-					filePathDeserializer(filePath);
-
-					for (const auto& keyVal : receivedData.colors)
-					{
-						i.state.receivedBuffer.colors[keyVal.first] = keyVal.second;
-					}
-
-					i.directoryPath = String(filePath.data());
-					i.phase = WaitingClient;
-					i.directoryWatcher = DirectoryWatcher(i.directoryPath);
-
-					const auto sendFilePath = i.directoryPath + U"receive.dat";
-					{
-						Serializer<BinaryWriter> serializer(sendFilePath);
-						serializer(detailImpl::EditorVersion);
-					}
-
-					//クライアントはサーバーと通信を行うよりも前に send.dat にバージョンを記録しているのでここで読めるはず
-					const auto receiveFilePath = i.directoryPath + U"send.dat";
-					if (!FileSystem::IsEmpty(receiveFilePath))
-					{
-						{
-							Deserializer<BinaryReader> deserializer(receiveFilePath);
-
-							unsigned version;
-							deserializer(version);
-
-							if (version != detailImpl::EditorVersion)
-							{
-								i.phase = Error;
-								break;
-							}
-						}
-
-						BinaryWriter writer(receiveFilePath);
-					}
-					else
-					{
-						i.phase = Error;
-						break;
-					}
-
-					const auto saveFilePath = i.directoryPath + U"save.dat";
-					if (FileSystem::Exists(saveFilePath) && !FileSystem::IsEmpty(saveFilePath))
-					{
-						Deserializer<BinaryReader> deserializer(saveFilePath);
-						deserializer(i.state);
-					}
-
-					break;
-				}
-
-				if (connected && !i.server.hasSession())
-				{
-					i.server.disconnect();
-					connected = false;
-					//Window::SetTitle(U"TCPServer: 再接続待機中...");
-					i.server.startAccept(PortNumber);
-				}
-
-				break;
-			}
-			case ParameterReceiver::WaitingClient:
-			{
-				const auto sendFilePath = i.directoryPath + U"receive.dat";
 
-				if (FileSystem::IsEmpty(sendFilePath))
-				{
-					i.phase = Running;
-					i.stopwatch.start();
+			i.state.receivedBuffer.merge(receivedValues);
+			i.latencyHistogram.add(i.server.takeLatencies());
+		}
 
-					i.server.disconnect();
-				}
+		SaveRecord record;
+		record.editedValues = i.state.editor.addMissing(i.state.receivedBuffer);
 
-				break;
-			}
-			case ParameterReceiver::Running:
-			{
-				const auto receiveFilePath = i.directoryPath + U"send.dat";
-				for (const auto& pathAction : i.directoryWatcher.retrieveChanges())
-				{
-					if (pathAction.first == receiveFilePath && !FileSystem::IsEmpty(receiveFilePath))
-					{
-						{
-							Deserializer<BinaryReader> deserializer(receiveFilePath);
-
-							ParameterData receivedData;
-							deserializer(receivedData);
-
-							for (const auto& keyVal : receivedData.colors)
-							{
-								i.state.receivedBuffer.colors[keyVal.first] = keyVal.second;
-							}
-						}
-
-						BinaryWriter writer(receiveFilePath);
-					}
-				}
-
-				const auto sendFilePath = i.directoryPath + U"receive.dat";
-				if (!i.sendBuffer.colors.empty() && FileSystem::IsEmpty(sendFilePath))
-				{
-					try
-					{
-						Serializer<BinaryWriter> serializer(sendFilePath);
-						serializer(i.sendBuffer);
-						i.sendBuffer = ParameterData();
-					}
-					catch (std::exception& e)
-					{
-						Logger << Unicode::Widen(e.what());
-					}
-				}
-
-				if (500 <= i.stopwatch.ms())
-				{
-					i.stopwatch.restart();
-					const auto saveFilePath = i.directoryPath + U"save.dat";
-					Serializer<BinaryWriter> serializer(saveFilePath);
-					serializer(i.state);
-				}
-
-				break;
-			}
-			default: break;
-			}
+		i.state.editor.update();
+		i.latencyHistogram.draw();
+
+		//名前の木でリセットされたフォルダの値は、ゲームが登録した時に送ってきた値に戻す
+		if (const auto prefix = i.state.editor.takeResetRequest())
+		{
+			i.state.editor.resetValues(prefix.value(), i.state.receivedBuffer);
+		}
+
+		//Ctrl + E で現在の値をリリースビルド用のヘッダーに書き出す(ゲーム側で PMT_BAKED_HEADER に指定する)
+		if (KeyControl.pressed() && KeyE.down())
+		{
+			const FilePath headerPath = FileSystem::FullPath(U"BakedParameters.hpp");
+			ReportStatus(BakedHeader::Write(i.state.editor.getValues(), headerPath)
+				? U"書き出しました: {}"_fmt(headerPath)
+				: U"書き出せませんでした: {}"_fmt(headerPath));
+		}
+
+		const auto updates = i.state.editor.getUpdates();
+		AddData(updates);
+
+		//ドラッグ中の変更は最新の値だけを残し、送信間隔を空けてまとめて送る(マウスを離したら即座に送る)
+		if (MouseL.up() || i.sendInterval <= i.sendStopwatch.sF())
+		{
+			i.flushOutbound();
+		}
+
+		//変更があった分だけ journal.dat に追記する(最後に追記した値と同じものは書かない)
+		record.editedValues.merge(updates);
+		record.editedValues.removeUnchanged(i.journaledValues);
+
+		if (i.journaledGroupsVersion != i.state.editor.getGroupsVersion())
+		{
+			i.journaledGroupsVersion = i.state.editor.getGroupsVersion();
+			record.hasColorGroups = true;
+			record.colorGroups = i.state.editor.getColorGroups();
+		}
+
+		if (i.journaledPositionsVersion != i.state.editor.getPositionsVersion())
+		{
+			i.journaledPositionsVersion = i.state.editor.getPositionsVersion();
+			record.hasGroupPositions = true;
+			record.groupPositions = i.state.editor.getGroupPositions();
+		}
+
+		if (!record.empty())
+		{
+			i.server.save(std::move(record));
 		}
 	}
 
-	ParameterReceiver()
+	static void SetTickRate(double tickRate)
 	{
-		worker = std::thread(ReceiveNewColors);
+		auto& i = instance();
+		i.server.setTickRate(tickRate);
 	}
 
-	ParameterReceiver(const ParameterReceiver&) = delete;
-
-	~ParameterReceiver()
+	//ゲームへ変更を送る 1 秒間あたりの最大回数(0 以下で制限なし)
+	static void SetMaxSendRate(double sendRate)
 	{
-		terminateAllThreads();
+		auto& i = instance();
+		i.sendInterval = sendRate <= 0.0 ? 0.0 : 1.0 / sendRate;
 	}
 
-	static ParameterReceiver& instance()
+	//変更した時刻を記録しておき、ゲームで読まれるまでの時間を計測する
+	static void AddData(const ParameterData& values)
 	{
-		static ParameterReceiver obj;
-		return obj;
+		auto& i = instance();
+		if (!values.empty() && i.outboundEditedAt == 0)
+		{
+			i.outboundEditedAt = TraceClock();
+		}
+		i.outboundBuffer.merge(values);
 	}
 
-	void terminateAllThreads()
+private:
+	//溜まった変更をワーカーの送信バッファに移す(メインスレッド専用)
+	void flushOutbound()
 	{
-		terminationRequest = true;
-		worker.join();
+		sendStopwatch.restart();
+		if (outboundBuffer.empty())
+		{
+			return;
+		}
+
+		server.send(outboundBuffer, outboundEditedAt);
+		outboundBuffer = ParameterData();
+		outboundEditedAt = 0;
 	}
 
-	enum Phase { Error, Ready, WaitingClient, Running };
+	ParameterReceiver() = default;
 
-	String directoryPath;
-	DirectoryWatcher directoryWatcher;
+	ParameterReceiver(const ParameterReceiver&) = delete;
 
-	TCPServer server;
-	std::thread worker;
-	ParameterData sendBuffer;
+	static ParameterReceiver& instance()
+	{
+		static ParameterReceiver obj;
+		return obj;
+	}
+
+	//通信と保存(描画・入力は使わない)
+	EditorServer server;
 
 	ServerState state;
 
-	bool terminationRequest = false;
-	bool reportUpdate = false;
+	//送信前に変更をまとめておくバッファ(メインスレッド専用)
+	ParameterData outboundBuffer;
+	int64 outboundEditedAt = 0;
+	Stopwatch sendStopwatch{ true };
+	double sendInterval = 1.0 / 60.0;
+
+	//journal.dat に最後に追記した値(同じ値を何度も書かないため)
+	ParameterData journaledValues;
+	uint64 journaledGroupsVersion = 0;
+	uint64 journaledPositionsVersion = 0;
 
-	Phase phase = Ready;
-	Stopwatch stopwatch;
+	LatencyHistogram latencyHistogram;
 };
 
 void Main()
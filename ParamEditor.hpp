@@ -1,30 +1,15 @@
-﻿#include <fstream>
-#include <thread>
-#include <mutex>
-
-#include <Siv3D.hpp> // OpenSiv3D v0.3.0
-
-#ifndef PMT_RELEASE_FLAG
-#define PMT_RELEASE_FLAG false
-#endif
+﻿#pragma once
+//エディタの画面(Siv3D のウィンドウ・描画・入力を使う部分)
+//モデルと通信は ParamEditorCore.hpp にあり、そちらは描画・入力を使わない(ただし Siv3D のアプリケーションの中で動かす)
+#include <unordered_set>
+#include "ParamEditorCore.hpp"
 
 namespace pmt
 {
 	namespace detailImpl
 	{
-		static constexpr uint16 PortNumber = 52823;
-		static constexpr unsigned EditorVersion = 1;
-
-		struct ParameterData
-		{
-			template <class Archive>
-			void SIV3D_SERIALIZE(Archive& archive)
-			{
-				archive(colors);
-			}
-
-			std::unordered_map<String, ColorF> colors;
-		};
+		//状態の通知はウィンドウのタイトルに出す
+		inline const bool WindowStatusHandlerInstalled = (GetStatusHandler() = [](const String& status) { Window::SetTitle(status); }, true);
 
 		class ColorEditor
 		{
@@ -37,9 +22,12 @@ namespace pmt
 				currentPos = Vec2(hsv.s, 1.0 - hsv.v);
 			}
 
-			void update()
+			//色が変わったら true を返す
+			bool update()
 			{
 				const Vec2 satBoxTL = colorBoxTL + Vec2(colorBoxWidth + satBoxInterval, 0);
+				const Vec2 previousPos = currentPos;
+				const double previousHuePos = currentHuePos;
 
 				{
 					//明度と彩度の操作
@@ -54,6 +42,8 @@ namespace pmt
 						currentHuePos = Saturate((Cursor::PosF().y - satBoxTL.y) / colorBoxWidth);
 					}
 				}
+
+				return currentPos != previousPos || currentHuePos != previousHuePos;
 			}
 
 			void draw()const
@@ -64,25 +54,8 @@ namespace pmt
 
 				//左のボックスの描画
 				{
-					const double currentH = 360.0 - 360.0*currentHuePos;
-					//RectF(colorBoxTL, colorBoxWidth, colorBoxWidth).drawFrame(3.0, Palette::Black);
-					//RectF(colorBoxTL, colorBoxWidth, colorBoxWidth).draw({ HSV(currentH, 0.0, 1.0),HSV(currentH, 1.0, 1.0),HSV(currentH, 1.0, 0.0),HSV(currentH, 0.0, 0.0) });
-
-					int divNum = 4;
-					const int unitWidth = colorBoxWidth / divNum;
-					for (int y = 0; y < divNum; ++y)
-					{
-						const double topV = 1.0 - 1.0*y / divNum;
-						const double bottomV = 1.0 - 1.0*(y + 1) / divNum;
-						for (int x = 0; x < divNum; ++x)
-						{
-							const double leftS = 1.0*x / divNum;
-							const double rightS = 1.0*(x + 1) / divNum;
-							RectF(colorBoxTL + Vec2(x, y)*unitWidth, unitWidth, unitWidth).draw({
-								HSV(currentH, leftS, topV),HSV(currentH, rightS, topV),HSV(currentH, rightS, bottomV),HSV(currentH, leftS, bottomV)
-								});
-						}
-					}
+					refreshSVField();
+					svTexture.draw(colorBoxTL);
 
 					const Color circleColor = currentPos.y < 0.3 ? Palette::Black : Palette::White;
 					getCircle().drawFrame(1.0, circleColor);
@@ -90,16 +63,20 @@ namespace pmt
 
 				//右のボックスの描画
 				{
-					const int divNum = 6;
-					for (int i = 0; i < divNum; ++i)
+					if (hueTexture.isEmpty())
 					{
-						const int unitHeight = colorBoxWidth / divNum;
-						const Vec2 currentSatBoxTL = satBoxTL + Vec2(0, i*unitHeight);
-						const double unitH = 360.0 / divNum;
-						const Color topColor = HSV(360.0 - unitH * i, 1.0, 1.0);
-						const Color bottomColor = HSV(360.0 - unitH * (i + 1), 1.0, 1.0);
-						RectF(currentSatBoxTL, satBoxWidth, unitHeight).draw({ topColor,topColor,bottomColor,bottomColor });
+						Image hueImage(satBoxWidth, colorBoxWidth);
+						for (int32 y = 0; y < colorBoxWidth; ++y)
+						{
+							const Color color = HSV(360.0 - 360.0 * y / colorBoxWidth, 1.0, 1.0);
+							for (int32 x = 0; x < satBoxWidth; ++x)
+							{
+								hueImage[y][x] = color;
+							}
+						}
+						hueTexture = Texture(hueImage);
 					}
+					hueTexture.draw(satBoxTL);
 
 					const Vec2 satLineLeft = satBoxTL + Vec2(0, colorBoxWidth*currentHuePos);
 					Line(satLineLeft, satLineLeft + Vec2(satBoxWidth, 0)).draw(1.0, Palette::Black);
@@ -138,6 +115,47 @@ namespace pmt
 				return Circle(colorBoxTL + currentPos * colorBoxWidth, 10.0);
 			}
 
+			//左のボックス(彩度と明度の面)は色相が変わった時だけ 1 ピクセルずつ作り直す
+			//HSV の定義から RGB = V * (1 - S + S * 純色) なので純色だけ求めれば足りる
+			void refreshSVField()const
+			{
+				if (svHuePos && svHuePos.value() == currentHuePos)
+				{
+					return;
+				}
+
+				const ColorF pureColor = HSV(360.0 - 360.0*currentHuePos, 1.0, 1.0).toColorF();
+				const double maxIndex = Max(colorBoxWidth - 1, 1);
+
+				if (svImage.width() != static_cast<uint32>(colorBoxWidth))
+				{
+					svImage = Image(colorBoxWidth, colorBoxWidth);
+				}
+				for (int32 y = 0; y < colorBoxWidth; ++y)
+				{
+					const double v = 1.0 - y / maxIndex;
+					Color* line = svImage[y];
+					for (int32 x = 0; x < colorBoxWidth; ++x)
+					{
+						const double s = x / maxIndex;
+						line[x] = ColorF(
+							v * (1.0 - s + s * pureColor.r),
+							v * (1.0 - s + s * pureColor.g),
+							v * (1.0 - s + s * pureColor.b)).toColor();
+					}
+				}
+
+				if (svTexture.isEmpty())
+				{
+					svTexture = DynamicTexture(svImage);
+				}
+				else
+				{
+					svTexture.fill(svImage);
+				}
+				svHuePos = currentHuePos;
+			}
+
 			int colorBoxWidth = 300;
 
 			int satBoxInterval = 10;
@@ -146,685 +164,1657 @@ namespace pmt
 			Vec2 currentPos = Vec2(0.0, 0.0); //[0.0, 1.0]
 			double currentHuePos = 0.0; //[0.0, 1.0]
 			String colorName = U"Color";
+
+			//描画用のキャッシュ(svHuePos は svTexture を作った時の色相)
+			mutable Image svImage;
+			mutable DynamicTexture svTexture;
+			mutable Optional<double> svHuePos;
+			mutable Texture hueTexture;
 		};
 
-		class MultiColorEditors
+		//ColorAnimation の編集パネル
+		//上段のタイムラインでキーを選ぶ(空いている所をクリックで追加、マーカーをドラッグで時刻を変更、右クリックで削除)
+		//選んだキーの色は ColorEditor と不透明度のバーで、次のキーまでの補間はボタンで切り替える
+		class AnimationEditor
 		{
 		public:
-			struct WindowIndex
-			{
-				size_t groupIndex;
-				size_t colorIndex;
-				WindowIndex() = default;
-				WindowIndex(size_t groupIndex, size_t colorIndex) :
-					groupIndex(groupIndex),
-					colorIndex(colorIndex)
-				{}
-
-				bool operator==(const WindowIndex& other)const
-				{
-					return groupIndex == other.groupIndex && colorIndex == other.colorIndex;
-				}
-			};
-
-			void add(const String& name, const Color& color)
+			AnimationEditor() = default;
+			AnimationEditor(const ColorAnimation& animation) :
+				animation(animation)
 			{
-				colors[name] = color;
-
-				if (colorGroups.empty())
+				if (!this->animation.keys.empty())
 				{
-					colorGroups.emplace_back();
-					groupPositions.push_back(Vec2(100, 100));
+					select(0);
 				}
-				colorGroups.back().push_back(name);
 			}
 
-			void update()
+			//変更があれば true を返す
+			bool update()
 			{
-				currentUpdates.clear();
+				bool changed = false;
+				auto& keys = animation.keys;
 
-				if (grabbingColor)
+				//タイムライン
+				if (draggingKey)
 				{
-					const auto& info = grabbingColor.value();
-
-					const WindowIndex index = searchByName(info.name).value();
-
-					//切り離された状態
-					if (colorGroups[index.groupIndex].size() == 1)
+					if (MouseL.pressed() && draggingKey.value() < keys.size())
 					{
-						groupPositions[index.groupIndex] = Cursor::PosF() - info.posOffset;
-
-						for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
+						const size_t index = draggingKey.value();
+						const double minTime = index == 0 ? 0.0 : keys[index - 1].time;
+						const double maxTime = index + 1 == keys.size() ? animation.duration : keys[index + 1].time;
+						const double time = Clamp(toTime(Cursor::PosF().x), minTime, maxTime);
+						if (time != keys[index].time)
 						{
-							if (groupIndex == index.groupIndex)
-							{
-								continue;
-							}
-
-							//既存のグループへのマージ
-							if (getGroupOuterScope(groupIndex).mouseOver())
-							{
-								colorGroups[groupIndex].push_back(info.name);
-								colorGroups.erase(colorGroups.begin() + index.groupIndex);
-								groupPositions.erase(groupPositions.begin() + index.groupIndex);
-								break;
-							}
+							keys[index].time = time;
+							changed = true;
 						}
 					}
-					//結合された状態
 					else
 					{
-						//グループからの切り離し
-						if (!getGroupOuterScope(index.groupIndex).mouseOver())
-						{
-							auto& currentGroup = colorGroups[index.groupIndex];
-							for (size_t colorIndex = 0; colorIndex < currentGroup.size(); ++colorIndex)
-							{
-								if (info.name == currentGroup[colorIndex])
-								{
-									currentGroup.erase(currentGroup.begin() + colorIndex);
-									break;
-								}
-							}
-							colorGroups.emplace_back();
-							colorGroups.back().push_back(info.name);
-							groupPositions.push_back(Cursor::PosF() - info.posOffset);
-						}
-						//グループ内での並べ替え
-						else
-						{
-							auto& currentGroup = colorGroups[index.groupIndex];
-							for (size_t colorIndex = 0; colorIndex < currentGroup.size(); ++colorIndex)
-							{
-								if (getColorScope({ index.groupIndex, colorIndex }).mouseOver() && index.colorIndex != colorIndex)
-								{
-									std::iter_swap(currentGroup.begin() + colorIndex, currentGroup.begin() + index.colorIndex);
-								}
-							}
-						}
-					}
-
-					if (MouseL.up())
-					{
-						grabbingColor = none;
+						draggingKey = none;
 					}
 				}
-				else if (grabbingGroup)
+				else if (const auto keyIndex = getKeyAt(Cursor::PosF()))
 				{
-					groupPositions[grabbingGroup.value()] += Cursor::DeltaF();
-					if (MouseL.up())
+					if (MouseL.down())
 					{
-						grabbingGroup = none;
+						select(keyIndex.value());
+						draggingKey = keyIndex;
+					}
+					else if (MouseR.down() && 1 < keys.size())
+					{
+						keys.erase(keys.begin() + keyIndex.value());
+						select(Min(keyIndex.value(), keys.size() - 1));
+						changed = true;
 					}
 				}
-				else if (edittingColor)
+				else if (getTimeline().leftClicked())
 				{
-					auto& edit = edittingColor.value();
-					edit.colorEditor.update();
-					colors[edit.name] = edit.colorEditor.getHSV();
-					currentUpdates.push_back(edit.name);
-
-					if (MouseL.down() && !(edit.colorEditor.getScope().mouseOver() || edit.colorEditor.getTabScope().mouseOver()))
+					const double time = toTime(Cursor::PosF().x);
+					size_t index = 0;
+					while (index < keys.size() && keys[index].time <= time)
 					{
-						edittingColor = none;
+						++index;
 					}
+
+					ColorKeyframe key;
+					key.time = time;
+					key.color = ColorF(AnimationEvaluator::Evaluate(animation, time));
+					key.easing = index == 0 ? AnimationEasing::Linear : keys[index - 1].easing;
+					keys.insert(keys.begin() + index, key);
+					select(index);
+					draggingKey = index;
+					changed = true;
 				}
 
-				//クリック操作
-				if (!grabbingColor && !grabbingGroup && !edittingColor)
+				//選んだキーの色と補間
+				if (selectedKey && selectedKey.value() < keys.size())
 				{
-					for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
-					{
-						for (size_t colorIndex = 0; colorIndex < colorGroups[groupIndex].size(); ++colorIndex)
-						{
-							const RectF innerScope = getInnerColorScope(WindowIndex(groupIndex, colorIndex));
+					auto& key = keys[selectedKey.value()];
 
-							if (innerScope.leftClicked())
-							{
-								const String& name = colorGroups[groupIndex][colorIndex];
-								edittingColor = EditColorInfo(name, colors[name]);
-								edittingColor.value().colorEditor.colorBoxTL = getColorScope({ groupIndex, colorIndex }).tr();
-							}
-						}
+					colorEditor.colorBoxTL = boxTL + Vec2(margin, colorEditorTop);
+					if (colorEditor.update())
+					{
+						const double alpha = key.color.a;
+						key.color = colorEditor.getHSV().toColorF();
+						key.color.a = alpha;
+						changed = true;
 					}
 
-					if (!edittingColor)
+					const RectF alphaBar = getAlphaBar();
+					if (alphaBar.stretched(0, 4).leftPressed())
 					{
-						for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
-						{
-							for (size_t colorIndex = 0; colorIndex < colorGroups[groupIndex].size(); ++colorIndex)
-							{
-								const RectF scope = getColorScope({ groupIndex, colorIndex });
-								if (scope.leftClicked())
-								{
-									const Vec2 offset = Cursor::PosF() - scope.pos;
-									grabbingColor = GrabInfo(colorGroups[groupIndex][colorIndex], offset);
-								}
-							}
-						}
+						key.color.a = Saturate((Cursor::PosF().x - alphaBar.x) / alphaBar.w);
+						changed = true;
 					}
 
-					if (!edittingColor && !grabbingColor)
+					if (getEasingButton().leftClicked())
 					{
-						for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
-						{
-							if (getGroupOuterScope(groupIndex).leftClicked() && !getGroupInnerScope(groupIndex).mouseOver())
-							{
-								grabbingGroup = groupIndex;
-							}
-						}
+						key.easing = static_cast<AnimationEasing>((static_cast<uint8>(key.easing) + 1) % EasingNames.size());
+						changed = true;
 					}
 				}
 
-				Optional<WindowIndex> grabbingColorIndex;
-				if (grabbingColor)
+				//長さ(左右にドラッグ)と繰り返し
+				if (getDurationBox().leftPressed() && Cursor::DeltaF().x != 0.0)
 				{
-					grabbingColorIndex = searchByName(grabbingColor.value().name);
+					const double lastTime = keys.empty() ? 0.0 : keys.back().time;
+					animation.duration = std::max({ animation.duration + Cursor::DeltaF().x * 0.01, lastTime, 0.01 });
+					changed = true;
 				}
 
-				//描画
-				for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
+				if (getLoopButton().leftClicked())
 				{
-					const auto& currentGroup = colorGroups[groupIndex];
-					const Vec2& groupTLPos = groupPositions[groupIndex];
-					getGroupOuterScope(groupIndex).draw(Palette::Gray);
-
-					for (size_t colorIndex = 0; colorIndex < currentGroup.size(); ++colorIndex)
-					{
-						unsigned alpha = 255;
-						if (grabbingColorIndex && grabbingColorIndex.value() == WindowIndex(groupIndex, colorIndex))
-						{
-							alpha = 128;
-						}
-						const Vec2 pos = groupTLPos + Vec2(0, colorIndex)*unitHeight;
-						drawColorScope({ groupIndex, colorIndex }, pos, alpha);
-					}
+					animation.loop = !animation.loop;
+					changed = true;
 				}
 
-				if (grabbingColor)
+				return changed;
+			}
+
+			void draw()const
+			{
+				getScope().draw(Color(96, 96, 96));
+
+				//タイムライン(色の変化を帯で見せる)
+				const RectF timeline = getTimeline();
+				timeline.draw(Color(32, 32, 32));
+				const size_t columns = static_cast<size_t>(timeline.w / 4);
+				for (size_t column = 0; column < columns; ++column)
 				{
-					getColorScope(searchByName(grabbingColor.value().name).value()).draw(Color(255, 255, 255, 64));
+					const double time = animation.duration * (column + 0.5) / columns;
+					RectF(timeline.x + timeline.w * column / columns, timeline.y, timeline.w / columns + 1, timeline.h)
+						.draw(AnimationEvaluator::Evaluate(animation, time));
 				}
-				else if (edittingColor)
+				timeline.drawFrame(1.0, Palette::Gray);
+
+				for (size_t keyIndex = 0; keyIndex < animation.keys.size(); ++keyIndex)
 				{
-					edittingColor.value().colorEditor.draw();
+					const RectF marker = getMarker(keyIndex);
+					marker.draw(animation.keys[keyIndex].color.toColor().setA(255));
+					marker.drawFrame(selectedKey == keyIndex ? 2.0 : 1.0, selectedKey == keyIndex ? Palette::White : Palette::Gray);
 				}
 
-				if (grabbingColorIndex)
+				if (selectedKey && selectedKey.value() < animation.keys.size())
 				{
-					const Vec2 drawPos = Cursor::PosF() - grabbingColor.value().posOffset;
-					drawColorScope(grabbingColorIndex.value(), drawPos);
+					const ColorKeyframe& key = animation.keys[selectedKey.value()];
+
+					colorEditor.draw();
+
+					const RectF alphaBar = getAlphaBar();
+					alphaBar.draw(Color(32, 32, 32));
+					RectF(alphaBar.pos, alphaBar.w * key.color.a, alphaBar.h).draw(key.color.toColor().setA(255));
+					alphaBar.drawFrame(1.0, Palette::Gray);
+
+					drawButton(getEasingButton(), EasingNames[static_cast<size_t>(key.easing)], false);
 				}
+
+				drawButton(getDurationBox(), ToString(animation.duration, 2) + U" s", false);
+				drawButton(getLoopButton(), U"Loop", animation.loop);
 			}
 
-			bool exists(const String& name)const
+			const ColorAnimation& getAnimation()const
 			{
-				return colors.find(name) != colors.end();
+				return animation;
 			}
 
-			std::unordered_map<String, Color> getUpdates()const
+			RectF getScope()const
 			{
-				std::unordered_map<String, Color> result;
-				for (const auto& name : currentUpdates)
-				{
-					result[name] = colors.find(name)->second;
-				}
-				return result;
+				return RectF(boxTL, panelWidth, controlsTop + controlHeight + margin);
 			}
 
-			const std::unordered_map<String, ColorF>& getColors()const
+			Vec2 boxTL = Vec2(100.0, 100.0);
+
+		private:
+			static constexpr std::array<const char32_t*, 5> EasingNames = { U"Linear", U"EaseIn", U"EaseOut", U"EaseInOut", U"Step" };
+
+			void select(size_t keyIndex)
 			{
-				return colors;
+				selectedKey = keyIndex;
+				colorEditor = ColorEditor(animation.keys[keyIndex].color.toColor());
+				colorEditor.colorBoxTL = boxTL + Vec2(margin, colorEditorTop);
 			}
 
-			template <class Archive>
-			void SIV3D_SERIALIZE(Archive& archive)
+			double toTime(double x)const
 			{
-				archive(colors, colorGroups, groupPositions);
+				const RectF timeline = getTimeline();
+				return Saturate((x - timeline.x) / timeline.w) * animation.duration;
 			}
 
-		private:
-			RectF getGroupOuterScope(size_t groupIndex)const
+			RectF getTimeline()const
 			{
-				const Vec2 colorScopeTL = groupPositions[groupIndex];
-				const double colorScopesHeight = colorGroups[groupIndex].size()*unitHeight;
-				return RectF(colorScopeTL - Vec2(0, tabHeight) - Vec2(groupMargin, groupMargin), width + groupMargin * 2, tabHeight + colorScopesHeight + groupMargin * 2);
+				return RectF(boxTL + Vec2(margin, margin), panelWidth - margin * 2, timelineHeight);
 			}
 
-			RectF getGroupInnerScope(size_t groupIndex)const
+			RectF getMarker(size_t keyIndex)const
 			{
-				const Vec2 colorScopeTL = groupPositions[groupIndex];
-				const double colorScopesHeight = colorGroups[groupIndex].size()*unitHeight;
-				return RectF(colorScopeTL, width, colorScopesHeight);
+				const RectF timeline = getTimeline();
+				const double rate = animation.duration <= 0.0 ? 0.0 : Saturate(animation.keys[keyIndex].time / animation.duration);
+				return RectF(timeline.x + timeline.w * rate - 5, timeline.y + timeline.h + 2, 10, markerHeight);
 			}
 
-			RectF getColorScope(const WindowIndex& index)const
+			Optional<size_t> getKeyAt(const Vec2& pos)const
 			{
-				const Vec2 pos = groupPositions[index.groupIndex] + Vec2(0, index.colorIndex)*unitHeight;
-				return RectF(pos, width, unitHeight);
+				for (size_t keyIndex = animation.keys.size(); 0 < keyIndex; --keyIndex)
+				{
+					if (getMarker(keyIndex - 1).intersects(pos))
+					{
+						return keyIndex - 1;
+					}
+				}
+				return none;
 			}
 
-			RectF getInnerColorScope(const WindowIndex& index)const
+			RectF getAlphaBar()const
 			{
-				const Vec2 pos = groupPositions[index.groupIndex] + Vec2(0, index.colorIndex)*unitHeight;
-				const RectF scope(pos, width, unitHeight);
-
-				const double innerMergin = 5.0;
-				const double innerHeight = unitHeight - innerMergin * 2;
-				const double innerWidth = innerHeight * 2;
-				const Vec2 innerRectTL = scope.br() - Vec2(innerWidth, innerHeight) - Vec2(innerMergin, innerMergin);
+				return RectF(boxTL + Vec2(margin, colorEditorTop + colorEditorHeight + margin), panelWidth - margin * 2, 16);
+			}
 
-				return RectF(innerRectTL, innerWidth, innerHeight);
+			RectF getEasingButton()const
+			{
+				return RectF(boxTL + Vec2(margin, controlsTop), 110, controlHeight);
 			}
 
-			RectF getInnerColorScope(const Vec2& scopeTLPos)const
+			RectF getDurationBox()const
 			{
-				const RectF scope(scopeTLPos, width, unitHeight);
+				return RectF(boxTL + Vec2(margin + 120, controlsTop), 110, controlHeight);
+			}
 
-				const double innerMergin = 5.0;
-				const double innerHeight = unitHeight - innerMergin * 2;
-				const double innerWidth = innerHeight * 2;
-				const Vec2 innerRectTL = scope.br() - Vec2(innerWidth, innerHeight) - Vec2(innerMergin, innerMergin);
+			RectF getLoopButton()const
+			{
+				return RectF(boxTL + Vec2(margin + 240, controlsTop), panelWidth - margin * 2 - 240, controlHeight);
+			}
 
-				return RectF(innerRectTL, innerWidth, innerHeight);
+			void drawButton(const RectF& rect, const String& text, bool active)const
+			{
+				rect.draw(active ? Color(Palette::Orange) : Color(64, 64, 64));
+				rect.drawFrame(1.0, rect.mouseOver() ? Palette::White : Palette::Gray);
+				font(text).drawAt(rect.center(), Palette::White);
 			}
 
-			Optional<WindowIndex> searchByName(const String& name)const
+			static constexpr double panelWidth = 360;
+			static constexpr double margin = 10;
+			static constexpr double timelineHeight = 30;
+			static constexpr double markerHeight = 12;
+			static constexpr double colorEditorTop = margin + timelineHeight + markerHeight + 12;
+			static constexpr double colorEditorHeight = 300;
+			static constexpr double controlsTop = colorEditorTop + colorEditorHeight + margin + 16 + margin;
+			static constexpr double controlHeight = 24;
+
+			ColorAnimation animation;
+			Optional<size_t> selectedKey;
+			Optional<size_t> draggingKey;
+			ColorEditor colorEditor;
+			Font font = Font(14);
+		};
+
+		//階層付きの名前の木を画面の左端に表示する(フォルダは折りたためる)
+		//名前の行をクリックするとその行へキャンバスを移動し、フォルダの行をクリックすると開閉する
+		//フォルダの右端のボタンでその下の値をゲームが登録した時の値に戻す
+		class ParameterTreeView
+		{
+		public:
+			struct Action
 			{
-				for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
+				enum class Kind { Focus, Reset };
+				Kind kind = Kind::Focus;
+				String path;
+			};
+
+			//表示する行は開いているフォルダの中だけを毎フレーム並べ直す
+			Optional<Action> update(const ParameterTree& tree)
+			{
+				rows.clear();
+				appendRows(tree, ParameterTree::Root);
+
+				const RectF scope = getScope();
+				if (!scope.mouseOver())
 				{
-					for (size_t colorIndex = 0; colorIndex < colorGroups[groupIndex].size(); ++colorIndex)
-					{
-						if (name == colorGroups[groupIndex][colorIndex])
-						{
-							return WindowIndex(groupIndex, colorIndex);
-						}
-					}
+					return none;
 				}
 
-				return none;
-			}
+				const double maxScroll = Max(0.0, rows.size() * rowHeight - scope.h);
+				scroll = Clamp(scroll + Mouse::Wheel() * rowHeight * 3, 0.0, maxScroll);
 
-			void drawColorScope(const WindowIndex& index, const Vec2& pos, unsigned alpha = 255)const
-			{
-				const String& name = colorGroups[index.groupIndex][index.colorIndex];
-				RectF(pos, width, unitHeight).draw(Color(32, 32, 32, alpha));
-				RectF(pos, width, unitHeight).drawFrame(1.0, Color(128, 128, 128, alpha));
-				font(name).draw(pos, Color(255, 255, 255, alpha));
+				if (!MouseL.down())
+				{
+					return none;
+				}
 
-				const RectF scope = getColorScope(index);
-				if (scope.mouseOver() && !grabbingColor && !grabbingGroup)
+				const size_t rowIndex = static_cast<size_t>((Cursor::PosF().y - scope.y + scroll) / rowHeight);
+				if (rows.size() <= rowIndex)
 				{
-					scope.draw(Color(255, 255, 255, 64));
+					return none;
 				}
 
-				const RectF innerScope = getInnerColorScope(pos);
-				innerScope.draw(Color(colors.find(name)->second).setA(alpha));
-				innerScope.drawFrame(1.0, Color(Palette::Gray).setA(alpha));
-			}
+				const Row& row = rows[rowIndex];
+				const ParameterTree::Node& node = tree.getNode(row.node);
+				if (row.entry)
+				{
+					return Action{ Action::Kind::Focus, node.entries[row.entry.value()].name };
+				}
 
-			Font font = Font(20);
+				if (getResetButton(rowIndex).mouseOver())
+				{
+					return Action{ Action::Kind::Reset, tree.getPath(row.node) };
+				}
 
-			int unitHeight = 50;
-			int width = 400;
+				if (!expanded.erase(row.node))
+				{
+					expanded.insert(row.node);
+				}
+				return none;
+			}
 
-			int tabHeight = 50;
-			int groupMargin = 1;
+			void draw(const ParameterTree& tree, const Optional<String>& focusedName)const
+			{
+				const RectF scope = getScope();
+				scope.draw(ColorF(0.0, 0.6));
 
-			std::unordered_map<String, ColorF> colors;
-			std::vector<std::vector<String>> colorGroups;
-			std::vector<Vec2> groupPositions;
+				const size_t beginRow = static_cast<size_t>(scroll / rowHeight);
+				const size_t endRow = std::min(rows.size(), static_cast<size_t>((scroll + scope.h) / rowHeight) + 1);
+				for (size_t rowIndex = beginRow; rowIndex < endRow; ++rowIndex)
+				{
+					const Row& row = rows[rowIndex];
+					const ParameterTree::Node& node = tree.getNode(row.node);
+					const RectF rowScope = getRow(rowIndex);
+					const Vec2 labelPos = rowScope.pos + Vec2(margin + indent * (node.depth - 1), 2);
 
-			std::vector<String> currentUpdates;
+					if (rowScope.mouseOver())
+					{
+						rowScope.draw(Color(255, 255, 255, 32));
+					}
 
-			struct GrabInfo
-			{
-				String name;
-				Vec2 posOffset;
-				GrabInfo() = default;
-				GrabInfo(const String& name, const Vec2& posOffset) :
-					name(name),
-					posOffset(posOffset)
-				{}
-			};
+					if (row.entry)
+					{
+						const String& name = node.entries[row.entry.value()].name;
+						if (focusedName && focusedName.value() == name)
+						{
+							rowScope.draw(Color(Palette::Orange).setA(96));
+						}
+						font(node.label).draw(labelPos + Vec2(indent, 0), Palette::White);
+					}
+					else
+					{
+						const bool opened = expanded.find(row.node) != expanded.end();
+						font(U"{} {} ({})"_fmt(opened ? U"-" : U"+", node.label, node.count)).draw(labelPos, Color(200, 200, 200));
 
-			struct EditColorInfo
+						const RectF resetButton = getResetButton(rowIndex);
+						resetButton.draw(Color(64, 64, 64));
+						resetButton.drawFrame(1.0, resetButton.mouseOver() ? Palette::White : Palette::Gray);
+						font(U"Reset").drawAt(resetButton.center(), Palette::White);
+					}
+				}
+
+				scope.drawFrame(1.0, Palette::Gray);
+			}
+
+			RectF getScope()const
 			{
-				String name;
-				ColorEditor colorEditor;
-				EditColorInfo() = default;
-				EditColorInfo(const String& name, const Color& color) :
-					name(name),
-					colorEditor(color)
-				{}
+				return RectF(0, 0, panelWidth, Window::Height());
+			}
+
+			//木を作り直した時は節の番号が変わるので開閉の状態を捨てる
+			void clear()
+			{
+				expanded.clear();
+				rows.clear();
+				scroll = 0.0;
+			}
+
+		private:
+			//entry が none ならフォルダの行
+			struct Row
+			{
+				uint32 node = ParameterTree::Root;
+				Optional<size_t> entry;
 			};
 
-			Optional<GrabInfo> grabbingColor;
-			Optional<size_t> grabbingGroup;
-			Optional<EditColorInfo> edittingColor;
+			//node の中身(名前を先に、続いて子のフォルダ)を並べる
+			void appendRows(const ParameterTree& tree, uint32 node)
+			{
+				const ParameterTree::Node& current = tree.getNode(node);
+				for (const auto& keyVal : current.children)
+				{
+					const ParameterTree::Node& child = tree.getNode(keyVal.second);
+					for (size_t entry = 0; entry < child.entries.size(); ++entry)
+					{
+						rows.push_back(Row{ keyVal.second, entry });
+					}
+				}
+
+				for (const auto& keyVal : current.children)
+				{
+					if (tree.getNode(keyVal.second).children.empty())
+					{
+						continue;
+					}
+
+					rows.push_back(Row{ keyVal.second, none });
+					if (expanded.find(keyVal.second) != expanded.end())
+					{
+						appendRows(tree, keyVal.second);
+					}
+				}
+			}
+
+			RectF getRow(size_t rowIndex)const
+			{
+				return RectF(0, rowIndex * rowHeight - scroll, panelWidth, rowHeight);
+			}
+
+			RectF getResetButton(size_t rowIndex)const
+			{
+				const RectF row = getRow(rowIndex);
+				return RectF(row.x + row.w - 54, row.y + 2, 50, row.h - 4);
+			}
+
+			static constexpr double panelWidth = 240;
+			static constexpr double rowHeight = 22;
+			static constexpr double indent = 14;
+			static constexpr double margin = 6;
+
+			std::unordered_set<uint32> expanded;
+			std::vector<Row> rows;
+			double scroll = 0.0;
+			Font font = Font(12);
 		};
 
-		struct ServerState
+		//グループの外枠を一定の大きさのマス目に登録しておき、ある位置に重なりうるグループだけを調べる
+		class GroupGrid
 		{
+		public:
+			void clear()
+			{
+				cells.clear();
+				groupCells.clear();
+			}
+
+			//groupIndex の枠を rect に置き直す
+			void set(size_t groupIndex, const RectF& rect)
+			{
+				remove(groupIndex);
+				if (groupCells.size() <= groupIndex)
+				{
+					groupCells.resize(groupIndex + 1);
+				}
+
+				const Point minCell = toCell(rect.pos);
+				const Point maxCell = toCell(rect.br());
+				auto& occupied = groupCells[groupIndex];
+				for (int32 y = minCell.y; y <= maxCell.y; ++y)
+				{
+					for (int32 x = minCell.x; x <= maxCell.x; ++x)
+					{
+						const uint64 key = toKey(x, y);
+						cells[key].push_back(groupIndex);
+						occupied.push_back(key);
+					}
+				}
+			}
+
+			void remove(size_t groupIndex)
+			{
+				if (groupCells.size() <= groupIndex)
+				{
+					return;
+				}
+
+				for (const uint64 key : groupCells[groupIndex])
+				{
+					auto& cell = cells[key];
+					cell.erase(std::remove(cell.begin(), cell.end(), groupIndex), cell.end());
+				}
+				groupCells[groupIndex].clear();
+			}
+
+			//rect の範囲のマス目に登録されているグループ(重複なし・昇順, 実際に重なっているかは呼び出し側で確かめる)
+			std::vector<size_t> query(const RectF& rect)const
+			{
+				std::vector<size_t> result;
+				const Point minCell = toCell(rect.pos);
+				const Point maxCell = toCell(rect.br());
+				for (int32 y = minCell.y; y <= maxCell.y; ++y)
+				{
+					for (int32 x = minCell.x; x <= maxCell.x; ++x)
+					{
+						const auto it = cells.find(toKey(x, y));
+						if (it != cells.end())
+						{
+							result.insert(result.end(), it->second.begin(), it->second.end());
+						}
+					}
+				}
+
+				std::sort(result.begin(), result.end());
+				result.erase(std::unique(result.begin(), result.end()), result.end());
+				return result;
+			}
+
+			//pos のマス目に登録されているグループ(実際に重なっているかは呼び出し側で確かめる)
+			const std::vector<size_t>& candidates(const Vec2& pos)const
+			{
+				static const std::vector<size_t> empty;
+				const Point cell = toCell(pos);
+				const auto it = cells.find(toKey(cell.x, cell.y));
+				return it == cells.end() ? empty : it->second;
+			}
+
+		private:
+			static Point toCell(const Vec2& pos)
+			{
+				return Point(static_cast<int32>(std::floor(pos.x / CellSize)), static_cast<int32>(std::floor(pos.y / CellSize)));
+			}
+
+			static uint64 toKey(int32 x, int32 y)
+			{
+				return (static_cast<uint64>(static_cast<uint32>(x)) << 32) | static_cast<uint32>(y);
+			}
+
+			static constexpr double CellSize = 256.0;
+
+			std::unordered_map<uint64, std::vector<size_t>> cells;
+			std::vector<std::vector<uint64>> groupCells;
+		};
+
+		//パラメータをグループごとに並べて編集する
+		//色は ColorEditor で、bool はクリックで、その他の型は値の枠を左右にドラッグして編集する
+		class MultiColorEditors
+		{
+		public:
+			struct WindowIndex
+			{
+				size_t groupIndex;
+				size_t colorIndex;
+				WindowIndex() = default;
+				WindowIndex(size_t groupIndex, size_t colorIndex) :
+					groupIndex(groupIndex),
+					colorIndex(colorIndex)
+				{}
+
+				bool operator==(const WindowIndex& other)const
+				{
+					return groupIndex == other.groupIndex && colorIndex == other.colorIndex;
+				}
+			};
+
+			template <class Type>
+			void add(const String& name, const typename ParameterTraits<Type>::DataType& value)
+			{
+				values.get<Type>()[name] = value;
+				types[name] = ParameterTraits<Type>::Kind;
+
+				//同じフォルダの名前が既に置かれていればそのグループに、無ければ新しいグループに加える
+				const uint32 node = tree.insert(name, ParameterTraits<Type>::Kind, 0);
+				Optional<size_t> groupIndex = findFolderGroup(node, name);
+				if (!groupIndex)
+				{
+					groupPositions.push_back(groupPositions.empty() ? Vec2(100, 100) : Vec2(groupPositions.back().x + width + 40, 100));
+					colorGroups.emplace_back();
+					groupIndex = colorGroups.size() - 1;
+					++positionsVersion;
+				}
+				auto& group = colorGroups[groupIndex.value()];
+				group.push_back(name);
+				nameIndices[name] = WindowIndex(groupIndex.value(), group.size() - 1);
+				invalidatePanel(groupIndex.value());
+				gridDirty = true;
+				++groupsVersion;
+
+				//追加は元に戻す対象にしない
+				history.add<Type>(name, value);
+				if (!grabbingColor && !grabbingGroup)
+				{
+					historyGroupsVersion = groupsVersion;
+					historyPositionsVersion = positionsVersion;
+				}
+			}
+
+			//キャンバスはスクロール・拡大縮小でき、画面に見えている部分だけを描画する
+			//左端には名前の木を重ねて表示する(カーソルが木の上にある間はキャンバスを操作しない)
+			void update()
+			{
+				const Optional<ParameterTreeView::Action> action = treeView.update(tree);
+				pointerOnTree = treeView.getScope().mouseOver();
+
+				if (!pointerOnTree)
+				{
+					updateView();
+				}
+
+				{
+					const Transformer2D transformer(Mat3x2::Translate(-scroll).scaled(zoom), true);
+					updateCanvas();
+				}
+
+				//木のクリックで色の編集などが閉じた後に処理する
+				if (action && isIdle())
+				{
+					if (action.value().kind == ParameterTreeView::Action::Kind::Focus)
+					{
+						focus(action.value().path);
+					}
+					else
+					{
+						resetRequest = action.value().path;
+					}
+				}
+
+				treeView.draw(tree, focusedName);
+			}
+
+			//名前の木でリセットが押されたフォルダ
+			Optional<String> takeResetRequest()
+			{
+				Optional<String> result = resetRequest;
+				resetRequest = none;
+				return result;
+			}
+
+			//prefix 以下の値を defaults(ゲームが登録した時の値)に戻す
+			//戻した値は通常の変更と同じようにゲームへ送られ、1 段として履歴に積まれる
+			void resetValues(const String& prefix, const ParameterData& defaults)
+			{
+				const auto node = tree.find(prefix);
+				if (!node)
+				{
+					return;
+				}
+
+				tree.forEach(node.value(), [&](const ParameterTree::Entry& entry)
+				{
+					ForEachParameterType([&](auto tag)
+					{
+						using Type = typename decltype(tag)::type;
+						if (ParameterTraits<Type>::Kind != entry.type)
+						{
+							return;
+						}
+
+						const auto it = defaults.get<Type>().find(entry.name);
+						if (it == defaults.get<Type>().end())
+						{
+							return;
+						}
+
+						values.get<Type>()[entry.name] = it->second;
+						copyValue(entry.name, values, historyChanges);
+						currentUpdates.push_back(entry.name);
+						invalidatePanel(nameIndices[entry.name].groupIndex);
+					});
+				});
+
+				if (isIdle())
+				{
+					commitHistory();
+				}
+			}
+
+			bool exists(const String& name)const
+			{
+				return types.find(name) != types.end();
+			}
+
+			//まだ無い名前を追加し、追加したものを返す
+			ParameterData addMissing(const ParameterData& received)
+			{
+				ParameterData added;
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					for (const auto& keyVal : received.get<Type>())
+					{
+						if (!exists(keyVal.first))
+						{
+							add<Type>(keyVal.first, keyVal.second);
+							added.get<Type>()[keyVal.first] = keyVal.second;
+						}
+					}
+				});
+				return added;
+			}
+
+			ParameterData getUpdates()const
+			{
+				ParameterData result;
+				for (const auto& name : currentUpdates)
+				{
+					copyValue(name, values, result);
+				}
+				return result;
+			}
+
+			const ParameterData& getValues()const
+			{
+				return values;
+			}
+
+			//グループの構成(並び順を含む)が変わるたびに増える
+			uint64 getGroupsVersion()const
+			{
+				return groupsVersion;
+			}
+
+			//グループの位置が変わるたびに増える
+			uint64 getPositionsVersion()const
+			{
+				return positionsVersion;
+			}
+
+			const std::vector<std::vector<String>>& getColorGroups()const
+			{
+				return colorGroups;
+			}
+
+			const std::vector<Vec2>& getGroupPositions()const
+			{
+				return groupPositions;
+			}
+
+			//セーブデータから復元する(操作中の状態は捨てる)
+			void restore(const EditorLayout& layout)
+			{
+				values = layout.values;
+				types.clear();
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					for (const auto& keyVal : values.get<Type>())
+					{
+						types[keyVal.first] = ParameterTraits<Type>::Kind;
+					}
+				});
+
+				tree.clear();
+				for (const auto& keyVal : types)
+				{
+					tree.insert(keyVal.first, keyVal.second, 0);
+				}
+				treeView.clear();
+				focusedName = none;
+
+				colorGroups = layout.colorGroups;
+				groupPositions = layout.groupPositions;
+				panels.clear();
+				nameIndices.clear();
+				reindexGroups(0);
+				++groupsVersion;
+				++positionsVersion;
+
+				grabbingColor = none;
+				grabbingGroup = none;
+				edittingColor = none;
+				edittingAnimation = none;
+				draggingValue = none;
+
+				history.reset(layout);
+				historyChanges = ParameterData();
+				historyGroupsVersion = groupsVersion;
+				historyPositionsVersion = positionsVersion;
+			}
+
+			//save.dat の形式(クライアントが値だけを読めるように値を先頭に置き、受信した値はその後ろに挟む)
 			template <class Archive>
-			void SIV3D_SERIALIZE(Archive& archive)
+			void serializeSave(Archive& archive, ParameterData& receivedBuffer)
+			{
+				archive(values, receivedBuffer, colorGroups, groupPositions);
+			}
+
+		private:
+			//ホイールで縦に(Shift を押しながらだと横に)スクロール、Ctrl + ホイールでカーソル位置を中心に拡大縮小、右ドラッグで移動
+			void updateView()
+			{
+				const Vec2 cursorPos = Cursor::PosF();
+				const double wheel = Mouse::Wheel();
+
+				if (KeyControl.pressed())
+				{
+					if (wheel != 0.0)
+					{
+						const Vec2 canvasPos = cursorPos / zoom + scroll;
+						zoom = Clamp(zoom * std::pow(1.1, -wheel), MinZoom, MaxZoom);
+						scroll = canvasPos - cursorPos / zoom;
+					}
+				}
+				else if (KeyShift.pressed())
+				{
+					scroll.x += wheel * ScrollSpeed / zoom;
+				}
+				else
+				{
+					scroll.y += wheel * ScrollSpeed / zoom;
+				}
+
+				if (MouseR.pressed())
+				{
+					scroll -= Cursor::DeltaF() / zoom;
+				}
+			}
+
+			//画面に見えているキャンバス上の範囲
+			RectF getViewport()const
 			{
-				archive(receivedBuffer, editor);
+				return RectF(scroll, Vec2(Window::Width(), Window::Height()) / zoom);
+			}
+
+			//ここでの座標はすべてキャンバス上の座標(カーソルも変換されている)
+			void updateCanvas()
+			{
+				currentUpdates.clear();
+
+				if (grabbingColor)
+				{
+					const auto& info = grabbingColor.value();
+
+					const WindowIndex index = searchByName(info.name).value();
+
+					//切り離された状態
+					if (colorGroups[index.groupIndex].size() == 1)
+					{
+						moveGroup(index.groupIndex, Cursor::PosF() - info.posOffset);
+
+						//既存のグループへのマージ
+						if (const auto groupIndex = getGroupAt(Cursor::PosF(), index.groupIndex))
+						{
+							colorGroups[groupIndex.value()].push_back(info.name);
+							colorGroups.erase(colorGroups.begin() + index.groupIndex);
+							groupPositions.erase(groupPositions.begin() + index.groupIndex);
+							reindexGroups(std::min(groupIndex.value(), index.groupIndex));
+							++groupsVersion;
+							++positionsVersion;
+						}
+					}
+					//結合された状態
+					else
+					{
+						//グループからの切り離し
+						if (!getGroupOuterScope(index.groupIndex).mouseOver())
+						{
+							auto& currentGroup = colorGroups[index.groupIndex];
+							for (size_t colorIndex = 0; colorIndex < currentGroup.size(); ++colorIndex)
+							{
+								if (info.name == currentGroup[colorIndex])
+								{
+									currentGroup.erase(currentGroup.begin() + colorIndex);
+									break;
+								}
+							}
+							colorGroups.emplace_back();
+							colorGroups.back().push_back(info.name);
+							groupPositions.push_back(Cursor::PosF() - info.posOffset);
+							reindexGroups(index.groupIndex);
+							++groupsVersion;
+							++positionsVersion;
+						}
+						//グループ内での並べ替え
+						else
+						{
+							const auto colorIndex = getRowAt(index.groupIndex, Cursor::PosF());
+							if (colorIndex && colorIndex.value() != index.colorIndex)
+							{
+								auto& currentGroup = colorGroups[index.groupIndex];
+								std::iter_swap(currentGroup.begin() + colorIndex.value(), currentGroup.begin() + index.colorIndex);
+								nameIndices[currentGroup[index.colorIndex]] = index;
+								nameIndices[currentGroup[colorIndex.value()]] = WindowIndex(index.groupIndex, colorIndex.value());
+								invalidatePanel(index.groupIndex);
+								++groupsVersion;
+							}
+						}
+					}
+
+					if (MouseL.up())
+					{
+						grabbingColor = none;
+					}
+				}
+				else if (grabbingGroup)
+				{
+					moveGroup(grabbingGroup.value(), groupPositions[grabbingGroup.value()] + Cursor::DeltaF());
+					if (MouseL.up())
+					{
+						grabbingGroup = none;
+					}
+				}
+				else if (draggingValue)
+				{
+					if (dragValue(Cursor::DeltaF().x))
+					{
+						currentUpdates.push_back(draggingValue.value().name);
+					}
+
+					if (MouseL.up())
+					{
+						draggingValue = none;
+					}
+				}
+				else if (edittingColor)
+				{
+					auto& edit = edittingColor.value();
+					if (edit.colorEditor.update())
+					{
+						values.colors[edit.name] = edit.colorEditor.getHSV();
+						currentUpdates.push_back(edit.name);
+					}
+
+					if (MouseL.down() && !(edit.colorEditor.getScope().mouseOver() || edit.colorEditor.getTabScope().mouseOver()))
+					{
+						edittingColor = none;
+					}
+				}
+				else if (edittingAnimation)
+				{
+					auto& edit = edittingAnimation.value();
+					if (edit.editor.update())
+					{
+						values.animations[edit.name] = edit.editor.getAnimation();
+						currentUpdates.push_back(edit.name);
+					}
+
+					if ((MouseL.down() || MouseR.down()) && !edit.editor.getScope().mouseOver())
+					{
+						edittingAnimation = none;
+					}
+				}
+
+				//クリック操作
+				//カーソルの下にあるグループと行だけを調べる
+				const Optional<size_t> clickedGroup = (MouseL.down() && !pointerOnTree) ? getGroupAt(Cursor::PosF()) : none;
+				if (isIdle() && clickedGroup)
+				{
+					const size_t groupIndex = clickedGroup.value();
+					if (const auto colorIndex = getRowAt(groupIndex, Cursor::PosF()))
+					{
+						const WindowIndex index(groupIndex, colorIndex.value());
+						const String& name = colorGroups[groupIndex][colorIndex.value()];
+						const RectF innerScope = getInnerScope(index);
+
+						if (innerScope.mouseOver())
+						{
+							switch (getType(name))
+							{
+							case ParameterType::Color:
+								edittingColor = EditColorInfo(name, values.colors[name]);
+								edittingColor.value().colorEditor.colorBoxTL = getColorScope(index).tr();
+								break;
+							case ParameterType::Bool:
+								values.bools[name] = !values.bools[name];
+								currentUpdates.push_back(name);
+								break;
+							case ParameterType::Animation:
+								edittingAnimation = EditAnimationInfo(name, values.animations[name]);
+								edittingAnimation.value().editor.boxTL = getColorScope(index).tr();
+								break;
+							default:
+								draggingValue = DragValueInfo(name, Cursor::PosF().x < innerScope.center().x ? 0 : 1);
+								break;
+							}
+						}
+						else
+						{
+							const Vec2 offset = Cursor::PosF() - getColorScope(index).pos;
+							grabbingColor = GrabInfo(name, offset);
+						}
+					}
+					else
+					{
+						grabbingGroup = groupIndex;
+					}
+				}
+
+				//操作中の変更は溜めておき、操作が終わった時に 1 段として履歴に積む
+				for (const auto& name : currentUpdates)
+				{
+					copyValue(name, values, historyChanges);
+				}
+
+				if (isIdle())
+				{
+					commitHistory();
+
+					//Ctrl + Z で元に戻す、Ctrl + Y (Ctrl + Shift + Z) でやり直す
+					if (KeyControl.pressed())
+					{
+						if (KeyZ.down() && !KeyShift.pressed())
+						{
+							applyHistory(history.undo());
+						}
+						else if (KeyY.down() || (KeyZ.down() && KeyShift.pressed()))
+						{
+							applyHistory(history.redo());
+						}
+					}
+				}
+
+				Optional<WindowIndex> grabbingColorIndex;
+				if (grabbingColor)
+				{
+					grabbingColorIndex = searchByName(grabbingColor.value().name);
+				}
+
+				//描画
+				//値が変わった行のパネルだけ描き直す
+				panels.resize(colorGroups.size());
+				for (const auto& name : currentUpdates)
+				{
+					invalidatePanel(nameIndices[name].groupIndex);
+				}
+
+				const Optional<size_t> hoveredGroup = (grabbingColor || grabbingGroup || pointerOnTree) ? none : getGroupAt(Cursor::PosF());
+				const RectF viewport = getViewport();
+				for (const size_t groupIndex : getGroupsIn(viewport))
+				{
+					Optional<size_t> hoveredRow;
+					if (hoveredGroup && hoveredGroup.value() == groupIndex)
+					{
+						hoveredRow = getRowAt(groupIndex, Cursor::PosF());
+					}
+
+					Optional<size_t> fadedRow;
+					if (grabbingColorIndex && grabbingColorIndex.value().groupIndex == groupIndex)
+					{
+						fadedRow = grabbingColorIndex.value().colorIndex;
+					}
+
+					drawGroup(groupIndex, viewport, hoveredRow, fadedRow);
+				}
+
+				//名前の木から移動してきた行をしばらく囲っておく
+				if (focusedName && focusStopwatch.sF() < FocusDuration)
+				{
+					if (const auto index = searchByName(focusedName.value()))
+					{
+						const double alpha = 1.0 - focusStopwatch.sF() / FocusDuration;
+						getColorScope(index.value()).drawFrame(3.0, ColorF(1.0, 0.65, 0.0, alpha));
+					}
+				}
+
+				if (grabbingColor)
+				{
+					getColorScope(searchByName(grabbingColor.value().name).value()).draw(Color(255, 255, 255, 64));
+				}
+				else if (edittingColor)
+				{
+					edittingColor.value().colorEditor.draw();
+				}
+				else if (edittingAnimation)
+				{
+					edittingAnimation.value().editor.draw();
+				}
+
+				if (grabbingColorIndex)
+				{
+					const Vec2 drawPos = Cursor::PosF() - grabbingColor.value().posOffset;
+					drawColorScope(grabbingColorIndex.value(), drawPos);
+				}
+			}
+
+			RectF getGroupOuterScope(size_t groupIndex)const
+			{
+				const Vec2 colorScopeTL = groupPositions[groupIndex];
+				const double colorScopesHeight = colorGroups[groupIndex].size()*unitHeight;
+				return RectF(colorScopeTL - Vec2(0, tabHeight) - Vec2(groupMargin, groupMargin), width + groupMargin * 2, tabHeight + colorScopesHeight + groupMargin * 2);
+			}
+
+			RectF getGroupInnerScope(size_t groupIndex)const
+			{
+				const Vec2 colorScopeTL = groupPositions[groupIndex];
+				const double colorScopesHeight = colorGroups[groupIndex].size()*unitHeight;
+				return RectF(colorScopeTL, width, colorScopesHeight);
 			}
 
-			ParameterData receivedBuffer;
-			MultiColorEditors editor;
-		};
+			RectF getColorScope(const WindowIndex& index)const
+			{
+				const Vec2 pos = groupPositions[index.groupIndex] + Vec2(0, index.colorIndex)*unitHeight;
+				return RectF(pos, width, unitHeight);
+			}
 
-		class ParameterEditor
-		{
-		public:
-			static void Update()
+			RectF getInnerScope(const WindowIndex& index)const
 			{
-				auto& i = instance();
-				i.reportUpdate = true;
+				const Vec2 pos = groupPositions[index.groupIndex] + Vec2(0, index.colorIndex)*unitHeight;
+				return getInnerScope(pos, colorGroups[index.groupIndex][index.colorIndex]);
 			}
 
-			static const Color& GetColor(const String& name)
+			//値の枠(色は見本、bool はチェックボックス、その他は数値)
+			RectF getInnerScope(const Vec2& scopeTLPos, const String& name)const
 			{
-				auto& i = instance();
-				if (i.colors.find(name) == i.colors.end())
+				const RectF scope(scopeTLPos, width, unitHeight);
+
+				const double innerMergin = 5.0;
+				const double innerHeight = unitHeight - innerMergin * 2;
+				double innerWidth = innerHeight * 2;
+				switch (getType(name))
 				{
-					std::lock_guard<std::mutex> lock(i.mtx);
-					i.colors[name] = RandomColor();
-					i.data1.colors[name] = i.colors[name];
+				case ParameterType::Color: innerWidth = innerHeight * 2; break;
+				case ParameterType::Bool: innerWidth = innerHeight; break;
+				default: innerWidth = innerHeight * 4; break;
 				}
+				const Vec2 innerRectTL = scope.br() - Vec2(innerWidth, innerHeight) - Vec2(innerMergin, innerMergin);
 
-				return i.colors[name];
+				return RectF(innerRectTL, innerWidth, innerHeight);
 			}
 
-		private:
-			ParameterEditor()
+			ParameterType getType(const String& name)const
+			{
+				return types.find(name)->second;
+			}
+
+			//draggingValue の component は Vec2 の x / y, ValueRange の min / max のどちらを動かすか
+			//値が変わったら true を返す(カーソルが止まっている間は何も送らない)
+			bool dragValue(double dx)
 			{
-				const String directoryName = U"ParameterEditor";
-				if (!FileSystem::Exists(directoryName))
+				if (dx == 0.0)
 				{
-					FileSystem::CreateDirectories(directoryName);
+					return false;
 				}
 
+				auto& info = draggingValue.value();
+				const double speed = KeyShift.pressed() ? 0.001 : 0.01;
+				switch (getType(info.name))
+				{
+				case ParameterType::Float:
+				{
+					values.floats[info.name] += dx * speed;
+					return true;
+				}
+				case ParameterType::Int:
 				{
-					const String versionFileName = directoryName + U"/version.dat";
-					const String saveFileName = directoryName + U"/save.dat";
-					if (FileSystem::Exists(versionFileName))
+					info.accumulated += dx / 8.0;
+					const int32 steps = static_cast<int32>(info.accumulated);
+					values.ints[info.name] += steps;
+					info.accumulated -= steps;
+					return steps != 0;
+				}
+				case ParameterType::Vec2:
+				{
+					Vec2& value = values.vec2s[info.name];
+					(info.component == 0 ? value.x : value.y) += dx * speed;
+					return true;
+				}
+				case ParameterType::Range:
+				{
+					ValueRange& value = values.ranges[info.name];
+					if (info.component == 0)
 					{
-						Deserializer<BinaryReader> versionDeserializer(versionFileName);
+						value.min = Min(value.min + dx * speed, value.max);
+					}
+					else
+					{
+						value.max = Max(value.max + dx * speed, value.min);
+					}
+					return true;
+				}
+				default: return false;
+				}
+			}
 
-						unsigned version;
-						versionDeserializer(version);
+			void drawValue(const String& name, const RectF& innerScope, unsigned alpha)const
+			{
+				const Color textColor(255, 255, 255, alpha);
+				const RectF leftHalf(innerScope.pos, innerScope.w / 2, innerScope.h);
+				const RectF rightHalf(innerScope.pos + Vec2(innerScope.w / 2, 0), innerScope.w / 2, innerScope.h);
 
-						if (version == EditorVersion)
-						{
-							phase = Ready;
+				switch (getType(name))
+				{
+				case ParameterType::Color:
+					innerScope.draw(Color(values.colors.find(name)->second).setA(alpha));
+					break;
+				case ParameterType::Bool:
+					innerScope.draw(Color(64, 64, 64, alpha));
+					if (values.bools.find(name)->second)
+					{
+						innerScope.stretched(-6).draw(Color(Palette::Orange).setA(alpha));
+					}
+					break;
+				case ParameterType::Float:
+					innerScope.draw(Color(64, 64, 64, alpha));
+					font(ToString(values.floats.find(name)->second, 3)).drawAt(innerScope.center(), textColor);
+					break;
+				case ParameterType::Int:
+					innerScope.draw(Color(64, 64, 64, alpha));
+					font(ToString(values.ints.find(name)->second)).drawAt(innerScope.center(), textColor);
+					break;
+				case ParameterType::Vec2:
+				{
+					const Vec2& value = values.vec2s.find(name)->second;
+					innerScope.draw(Color(64, 64, 64, alpha));
+					font(ToString(value.x, 2)).drawAt(leftHalf.center(), textColor);
+					font(ToString(value.y, 2)).drawAt(rightHalf.center(), textColor);
+					Line(leftHalf.tr(), leftHalf.br()).draw(1.0, Color(Palette::Gray).setA(alpha));
+					break;
+				}
+				case ParameterType::Range:
+				{
+					const ValueRange& value = values.ranges.find(name)->second;
+					innerScope.draw(Color(64, 64, 64, alpha));
+					font(ToString(value.min, 2)).drawAt(leftHalf.center(), textColor);
+					font(ToString(value.max, 2)).drawAt(rightHalf.center(), textColor);
+					Line(leftHalf.tr(), leftHalf.br()).draw(1.0, Color(Palette::Gray).setA(alpha));
+					break;
+				}
+				case ParameterType::Animation:
+				{
+					//1 周分の色の変化を帯で見せる
+					const ColorAnimation& animation = values.animations.find(name)->second;
+					innerScope.draw(Color(64, 64, 64, alpha));
+					const size_t columns = 16;
+					for (size_t column = 0; column < columns; ++column)
+					{
+						const Color color = AnimationEvaluator::Evaluate(animation, animation.duration * (column + 0.5) / columns);
+						RectF(innerScope.x + innerScope.w * column / columns, innerScope.y, innerScope.w / columns + 1, innerScope.h)
+							.draw(Color(color).setA(color.a * alpha / 255));
+					}
+					break;
+				}
+				default: break;
+				}
+			}
 
-							//データの復元はサーバー非依存に行える必要があるので初期化時にクライアントでも開く
-							if (FileSystem::Exists(saveFileName) && !FileSystem::IsEmpty(saveFileName))
-							{
-								Deserializer<BinaryReader> deserializer(saveFileName);
+			//名前の行が画面の(名前の木を除いた部分の)中央に来るようにキャンバスを動かす
+			void focus(const String& name)
+			{
+				const auto index = searchByName(name);
+				if (!index)
+				{
+					return;
+				}
 
-								ServerState initialState;
-								deserializer(initialState);
+				const double treeWidth = treeView.getScope().w;
+				const Vec2 screenCenter((treeWidth + Window::Width()) / 2.0, Window::Height() / 2.0);
+				scroll = getColorScope(index.value()).center() - screenCenter / zoom;
+				focusedName = name;
+				focusStopwatch.restart();
+			}
 
-								//for (const auto& keyVal : initialState.receivedBuffer.colors)
-								for (const auto& keyVal : initialState.editor.getColors())
-								{
-									colors[keyVal.first] = keyVal.second;
-								}
-							}
-							else
-							{
-								BinaryWriter writer(saveFileName);
-							}
-						}
-					}
-					else
+			//node と同じフォルダにある名前のうち、既に置かれているもののグループ
+			//フォルダの中を先頭から調べ、最初に見つかったものを使う(ほとんどの場合すぐに見つかる)
+			Optional<size_t> findFolderGroup(uint32 node, const String& name)const
+			{
+				const ParameterTree::Node& folder = tree.getNode(tree.getNode(node).parent);
+				for (const auto& keyVal : folder.children)
+				{
+					for (const auto& entry : tree.getNode(keyVal.second).entries)
 					{
-						Serializer<BinaryWriter> serializer(versionFileName);
-						serializer(EditorVersion);
-						phase = Ready;
-
-						if (FileSystem::Exists(saveFileName))
+						if (entry.name == name)
 						{
-							phase = Beginning;
+							continue;
 						}
-						else
+
+						if (const auto index = searchByName(entry.name))
 						{
-							BinaryWriter writer(saveFileName);
+							return index.value().groupIndex;
 						}
 					}
 				}
+				return none;
+			}
 
-				//ここ以降での phase == Beginning はエラー状態として扱う
-
-				{
-					const String fileName = directoryName + U"/send.dat";
-					Serializer<BinaryWriter> serializer(fileName);
-					//phase が Ready になってない時は version.dat と EditorVersion が一致しない可能性がある
-					//サーバー側でクライアントの EditorVersion を把握するため送っておく
-					serializer(EditorVersion);
-				}
+			Optional<WindowIndex> searchByName(const String& name)const
+			{
+				const auto it = nameIndices.find(name);
+				if (it == nameIndices.end())
 				{
-					const String fileName = directoryName + U"/receive.dat";
-					BinaryWriter writer(fileName);
+					return none;
 				}
+				return it->second;
+			}
 
-				if (PMT_RELEASE_FLAG)
-				{
-					phase = Beginning;
-				}
-				else
+			bool isIdle()const
+			{
+				return !grabbingColor && !grabbingGroup && !edittingColor && !edittingAnimation && !draggingValue;
+			}
+
+			void copyValue(const String& name, const ParameterData& source, ParameterData& destination)const
+			{
+				const ParameterType type = getType(name);
+				ForEachParameterType([&](auto tag)
 				{
-					const auto path = FileSystem::FullPath(directoryName);
-					std::array<char32_t, 256> filePath{};
-					for (auto ic : Indexed(path))
+					using Type = typename decltype(tag)::type;
+					if (ParameterTraits<Type>::Kind == type)
 					{
-						filePath[ic.first] = ic.second;
+						destination.get<Type>()[name] = source.get<Type>().find(name)->second;
 					}
-					directoryPath = path;
-					directoryWatcher = DirectoryWatcher(directoryPath);
-
-					Serializer<MemoryWriter> serializer;
-					serializer(filePath);
-					const auto& writer = serializer.getWriter();
-					sendData = ByteArray(writer.data(), static_cast<size_t>(writer.size()));
+				});
+			}
 
-					worker1 = std::thread(ReportNewColors);
+			void commitHistory()
+			{
+				const bool layoutChanged = historyGroupsVersion != groupsVersion || historyPositionsVersion != positionsVersion;
+				if (historyChanges.empty() && !layoutChanged)
+				{
+					return;
 				}
+
+				history.commit(historyChanges, layoutChanged, colorGroups, groupPositions);
+				historyChanges = ParameterData();
+				historyGroupsVersion = groupsVersion;
+				historyPositionsVersion = positionsVersion;
 			}
 
-			//新しく追加された色をサーバーに送る
-			static void ReportNewColors()
+			//戻した値は通常の変更と同じようにゲームへ送られ、保存される
+			void applyHistory(const Optional<EditorHistory::Change>& change)
 			{
-				auto& i = instance();
-				i.client.connect(IPv4::localhost(), PortNumber);
+				if (!change)
+				{
+					return;
+				}
 
-				while (!i.terminationRequest)
+				ForEachParameterType([&](auto tag)
 				{
-					if (!i.reportUpdate)
+					using Type = typename decltype(tag)::type;
+					for (const auto& keyVal : change.value().values.get<Type>())
 					{
-						continue;
+						values.get<Type>()[keyVal.first] = keyVal.second;
+						currentUpdates.push_back(keyVal.first);
 					}
-					i.reportUpdate = false;
+				});
 
-					switch (i.phase)
-					{
-					case ParameterEditor::Beginning:
+				if (change.value().layoutChanged)
+				{
+					colorGroups = change.value().colorGroups;
+					groupPositions = change.value().groupPositions;
+
+					//その段より後に追加された名前は最後のグループに加える
+					std::unordered_set<String> placedNames;
+					for (const auto& group : colorGroups)
 					{
-						Window::SetTitle(U"初期化に失敗");
-						break;
+						placedNames.insert(group.begin(), group.end());
 					}
-					case ParameterEditor::Ready:
+					for (const auto& keyVal : types)
 					{
-						if (i.client.isConnected())
-						{
-							//Window::SetTitle(U"TCPClient: 接続完了！");
-
-							i.client.send(i.sendData.data(), 4 * 256);
-							i.sendData = ByteArray();
-							i.phase = WaitingServer;
-
-							break;
-						}
-
-						if (i.client.hasError())
+						if (placedNames.find(keyVal.first) == placedNames.end())
 						{
-							i.client.disconnect();
-							//Window::SetTitle(U"TCPClient: 再接続待機中...");
-							i.client.connect(IPv4::localhost(), PortNumber);
+							if (colorGroups.empty())
+							{
+								colorGroups.emplace_back();
+								groupPositions.push_back(Vec2(100, 100));
+							}
+							colorGroups.back().push_back(keyVal.first);
 						}
-
-						break;
 					}
-					case ParameterEditor::WaitingServer:
-					{
-						const FilePath receiveFilePath = i.directoryPath + U"receive.dat";
-						const FilePath sendFilePath = i.directoryPath + U"send.dat";
 
-						/*
-						メインスレッドの方がこっちのスレッドより多く回る可能性がある
-						->DirectoryWatcherが捕捉を漏らす可能性がある？あるとしたらここでは使うべきでない
+					panels.clear();
+					nameIndices.clear();
+					reindexGroups(0);
+					++groupsVersion;
+					++positionsVersion;
+				}
 
-						クライアント側では、send.dat にバージョン情報を書き込んだ後に通信を始める
-						サーバー側では、receive.dat にバージョン情報を書き込んだ後に send.dat の中身をクリアする
-						したがって、ここで send.dat の中身が空だった時は、確実に receive.dat には有効な値が入っているはず
-						*/
+				historyGroupsVersion = groupsVersion;
+				historyPositionsVersion = positionsVersion;
+			}
 
-						if (FileSystem::IsEmpty(sendFilePath))
-						{
-							{
-								Deserializer<BinaryReader> deserializer(receiveFilePath);
+			//firstGroup 以降のグループの並びが変わった時に名前の索引を付け直す
+			//マス目は次に当たり判定をする時に作り直す
+			void reindexGroups(size_t firstGroup)
+			{
+				for (size_t groupIndex = firstGroup; groupIndex < colorGroups.size(); ++groupIndex)
+				{
+					for (size_t colorIndex = 0; colorIndex < colorGroups[groupIndex].size(); ++colorIndex)
+					{
+						nameIndices[colorGroups[groupIndex][colorIndex]] = WindowIndex(groupIndex, colorIndex);
+					}
+					invalidatePanel(groupIndex);
+				}
+				gridDirty = true;
+			}
 
-								unsigned version;
-								deserializer(version);
+			void invalidatePanel(size_t groupIndex)
+			{
+				if (groupIndex < panels.size())
+				{
+					panels[groupIndex].dirty = true;
+				}
+			}
 
-								if (version != EditorVersion)
-								{
-									i.phase = Beginning;
-								}
-								else
-								{
-									i.phase = Running;
-									i.client.disconnect();
-								}
+			//グループのパネルを RenderTexture に描いておき、内容・大きさ・カーソルの当たっている行・掴んでいる行が変わった時だけ描き直す
+			void drawGroup(size_t groupIndex, const RectF& viewport, const Optional<size_t>& hoveredRow, const Optional<size_t>& fadedRow)
+			{
+				const RectF outerScope = getGroupOuterScope(groupIndex);
+				const Size size(static_cast<int32>(std::ceil(outerScope.w)), static_cast<int32>(std::ceil(outerScope.h)));
 
-							}
+				//テクスチャに収まらない大きさのグループは見えている行だけを毎フレーム直接描く
+				if (MaxPanelHeight < size.y)
+				{
+					const double top = groupPositions[groupIndex].y;
+					const size_t beginRow = static_cast<size_t>(Max(0.0, std::floor((viewport.y - top) / unitHeight)));
+					const size_t endRow = static_cast<size_t>(Max(0.0, std::ceil((viewport.y + viewport.h - top) / unitHeight)));
+					drawGroupScopes(groupIndex, outerScope.pos, hoveredRow, fadedRow, beginRow, endRow);
+					return;
+				}
 
-							BinaryWriter writer(receiveFilePath);
-						}
+				auto& panel = panels[groupIndex];
+				if (panel.texture.size() != size)
+				{
+					panel.texture = RenderTexture(size);
+					panel.dirty = true;
+				}
 
-						break;
-					}
-					case ParameterEditor::Running:
+				if (panel.dirty || panel.hoveredRow != hoveredRow || panel.fadedRow != fadedRow)
+				{
+					panel.texture.clear(ColorF(0.0, 0.0));
 					{
-						std::lock_guard<std::mutex> lock(i.mtx);
+						//テクスチャにはキャンバスの変換を掛けずに描き、変換は下で貼り付ける時にだけ掛ける
+						ScopedRenderTarget2D target(panel.texture);
+						const Transformer2D identity(Mat3x2::Identity(), false, Transformer2D::Target::SetLocal);
+						drawGroupScopes(groupIndex, Vec2(0, 0), hoveredRow, fadedRow);
+					}
+					panel.dirty = false;
+					panel.hoveredRow = hoveredRow;
+					panel.fadedRow = fadedRow;
+				}
 
-						const FilePath receiveFilePath = i.directoryPath + U"receive.dat";
-						for (const auto& pathAction : i.directoryWatcher.retrieveChanges())
-						{
-							if (pathAction.first == receiveFilePath && !FileSystem::IsEmpty(receiveFilePath))
-							{
-								//ここのデシリアライズで失敗した(理由不明)
-								try
-								{
-									Deserializer<BinaryReader> deserializer(receiveFilePath);
+				panel.texture.draw(outerScope.pos);
+			}
 
-									ParameterData receivedData;
-									deserializer(receivedData);
+			//outerTL はグループの外枠の左上
+			//[beginRow, endRow) の行だけを描く
+			void drawGroupScopes(size_t groupIndex, const Vec2& outerTL, const Optional<size_t>& hoveredRow, const Optional<size_t>& fadedRow,
+				size_t beginRow = 0, size_t endRow = SIZE_MAX)const
+			{
+				const RectF outerScope = getGroupOuterScope(groupIndex);
+				RectF(outerTL, outerScope.size).draw(Palette::Gray);
 
-									for (const auto& keyVal : receivedData.colors)
-									{
-										i.colors[keyVal.first] = keyVal.second;
-									}
-								}
-								catch (std::exception& e)
-								{
-									Logger << Unicode::Widen(e.what());
-								}
+				const Vec2 groupTLPos = outerTL + (groupPositions[groupIndex] - outerScope.pos);
+				endRow = std::min(endRow, colorGroups[groupIndex].size());
+				for (size_t colorIndex = beginRow; colorIndex < endRow; ++colorIndex)
+				{
+					const unsigned alpha = (fadedRow && fadedRow.value() == colorIndex) ? 128 : 255;
+					const bool highlighted = hoveredRow && hoveredRow.value() == colorIndex;
+					const Vec2 pos = groupTLPos + Vec2(0, colorIndex)*unitHeight;
+					drawColorScope({ groupIndex, colorIndex }, pos, alpha, highlighted);
+				}
+			}
 
-								BinaryWriter writer(receiveFilePath);
-							}
-						}
+			void moveGroup(size_t groupIndex, const Vec2& pos)
+			{
+				groupPositions[groupIndex] = pos;
+				++positionsVersion;
 
-						const FilePath sendFilePath = i.directoryPath + U"send.dat";
-						if (!i.data1.colors.empty() && FileSystem::IsEmpty(sendFilePath))
-						{
-							try
-							{
-								Serializer<BinaryWriter> serializer(sendFilePath);
-								serializer(i.data1);
-								i.data1 = ParameterData();
-							}
-							catch (std::exception& e)
-							{
-								Logger << Unicode::Widen(e.what());
-							}
-						}
+				if (!gridDirty)
+				{
+					grid.set(groupIndex, getGroupOuterScope(groupIndex));
+				}
+			}
 
-						break;
-					}
-					default: break;
+			//pos に重なっているグループのうち一番手前(後に描画される)もの
+			Optional<size_t> getGroupAt(const Vec2& pos, const Optional<size_t>& excluded = none)
+			{
+				refreshGrid();
+
+				Optional<size_t> result;
+				for (const size_t groupIndex : grid.candidates(pos))
+				{
+					if ((!excluded || groupIndex != excluded.value()) && (!result || result.value() < groupIndex) && getGroupOuterScope(groupIndex).intersects(pos))
+					{
+						result = groupIndex;
 					}
 				}
+				return result;
 			}
 
-			ParameterEditor(const ParameterEditor&) = delete;
+			//rect に重なっているグループ(描画順)
+			std::vector<size_t> getGroupsIn(const RectF& rect)
+			{
+				refreshGrid();
+
+				std::vector<size_t> result;
+				for (const size_t groupIndex : grid.query(rect))
+				{
+					if (getGroupOuterScope(groupIndex).intersects(rect))
+					{
+						result.push_back(groupIndex);
+					}
+				}
+				return result;
+			}
 
-			~ParameterEditor()
+			void refreshGrid()
 			{
-				terminateAllThreads();
+				if (!gridDirty)
+				{
+					return;
+				}
+
+				grid.clear();
+				for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
+				{
+					grid.set(groupIndex, getGroupOuterScope(groupIndex));
+				}
+				gridDirty = false;
 			}
 
-			static ParameterEditor& instance()
+			//pos がグループの何行目にあるか(タブの上なら none)
+			Optional<size_t> getRowAt(size_t groupIndex, const Vec2& pos)const
 			{
-				static ParameterEditor obj;
-				return obj;
+				if (colorGroups[groupIndex].empty() || !getGroupInnerScope(groupIndex).intersects(pos))
+				{
+					return none;
+				}
+
+				const size_t colorIndex = static_cast<size_t>((pos.y - groupPositions[groupIndex].y) / unitHeight);
+				return std::min(colorIndex, colorGroups[groupIndex].size() - 1);
 			}
 
-			void terminateAllThreads()
+			void drawColorScope(const WindowIndex& index, const Vec2& pos, unsigned alpha = 255, bool highlighted = false)const
 			{
-				terminationRequest = true;
-				if (worker1.joinable())
+				const String& name = colorGroups[index.groupIndex][index.colorIndex];
+				RectF(pos, width, unitHeight).draw(Color(32, 32, 32, alpha));
+				RectF(pos, width, unitHeight).drawFrame(1.0, Color(128, 128, 128, alpha));
+				font(name).draw(pos, Color(255, 255, 255, alpha));
+
+				if (highlighted)
 				{
-					worker1.join();
+					RectF(pos, width, unitHeight).draw(Color(255, 255, 255, 64));
 				}
+
+				const RectF innerScope = getInnerScope(pos, name);
+				drawValue(name, innerScope, alpha);
+				innerScope.drawFrame(1.0, Color(Palette::Gray).setA(alpha));
 			}
 
-			enum Phase { Beginning, Ready, WaitingServer, Running };
-			//Beginning     初期状態(or初期化に失敗)
-			//Ready         クライアントとセーブデータのバージョン番号の一致を確認(通信待機状態)
-			//WaitingServer ディレクトリ情報の送信完了(receive.datの更新待機状態)
-			//Running       クライアントとサーバーのバージョン番号の一致を確認(通常状態)
+			Font font = Font(20);
+
+			int unitHeight = 50;
+			int width = 400;
+
+			int tabHeight = 50;
+			int groupMargin = 1;
+
+			ParameterData values;
+			std::unordered_map<String, ParameterType> types;
+			std::vector<std::vector<String>> colorGroups;
+			std::vector<Vec2> groupPositions;
+
+			std::vector<String> currentUpdates;
+
+			//階層付きの名前の索引(ParameterTree::Entry の index は使わない)と、それを表示する木
+			ParameterTree tree;
+			ParameterTreeView treeView;
+			bool pointerOnTree = false;
+			Optional<String> resetRequest;
+			Optional<String> focusedName;
+			Stopwatch focusStopwatch;
+
+			static constexpr double FocusDuration = 1.0;
+
+			//名前から位置を引く索引と、グループの当たり判定用のマス目
+			std::unordered_map<String, WindowIndex> nameIndices;
+			GroupGrid grid;
+			bool gridDirty = true;
+
+			uint64 groupsVersion = 0;
+			uint64 positionsVersion = 0;
+
+			//元に戻す・やり直すための履歴と、まだ積んでいない操作中の変更
+			EditorHistory history;
+			ParameterData historyChanges;
+			uint64 historyGroupsVersion = 0;
+			uint64 historyPositionsVersion = 0;
+
+			struct GrabInfo
+			{
+				String name;
+				Vec2 posOffset;
+				GrabInfo() = default;
+				GrabInfo(const String& name, const Vec2& posOffset) :
+					name(name),
+					posOffset(posOffset)
+				{}
+			};
+
+			struct DragValueInfo
+			{
+				String name;
+				size_t component = 0;
+				double accumulated = 0.0;
+				DragValueInfo() = default;
+				DragValueInfo(const String& name, size_t component) :
+					name(name),
+					component(component)
+				{}
+			};
+
+			struct EditColorInfo
+			{
+				String name;
+				ColorEditor colorEditor;
+				EditColorInfo() = default;
+				EditColorInfo(const String& name, const Color& color) :
+					name(name),
+					colorEditor(color)
+				{}
+			};
+
+			Optional<GrabInfo> grabbingColor;
+			Optional<size_t> grabbingGroup;
+			struct EditAnimationInfo
+			{
+				String name;
+				AnimationEditor editor;
+				EditAnimationInfo() = default;
+				EditAnimationInfo(const String& name, const ColorAnimation& animation) :
+					name(name),
+					editor(animation)
+				{}
+			};
+
+			Optional<EditColorInfo> edittingColor;
+			Optional<EditAnimationInfo> edittingAnimation;
+			Optional<DragValueInfo> draggingValue;
 
-			TCPClient client;
-			uint32 receivedVal = 0;
-			std::unordered_map<String, Color> colors;
-			ParameterData data1;
+			//グループごとの描画結果
+			struct PanelCache
+			{
+				RenderTexture texture;
+				bool dirty = true;
+				Optional<size_t> hoveredRow;
+				Optional<size_t> fadedRow;
+			};
 
-			ByteArray sendData;
-			String directoryPath;
-			DirectoryWatcher directoryWatcher;
+			static constexpr int32 MaxPanelHeight = 8192;
 
-			std::thread worker1;
-			std::mutex mtx;
+			std::vector<PanelCache> panels;
 
-			bool terminationRequest = false;
-			bool reportUpdate = false;
+			//キャンバスの表示位置(画面左上に来るキャンバス上の座標)と倍率
+			//最初は名前の木に隠れないように右へずらしておく
+			Vec2 scroll = Vec2(-260, 0);
+			double zoom = 1.0;
 
-			Phase phase = Beginning;
+			static constexpr double MinZoom = 0.25;
+			static constexpr double MaxZoom = 4.0;
+			static constexpr double ScrollSpeed = 60.0;
 		};
-	}
 
-	inline void Update()
-	{
-		detailImpl::ParameterEditor::Update();
-	}
+		struct ServerState
+		{
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				editor.serializeSave(archive, receivedBuffer);
+			}
 
-	inline const Color& GetColor(const String& name)
-	{
-		return detailImpl::ParameterEditor::GetColor(name);
+			ParameterData receivedBuffer;
+			MultiColorEditors editor;
+		};
 	}
 }
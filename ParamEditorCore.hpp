@@ -0,0 +1,4231 @@
+﻿#pragma once
+#include <fstream>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <sstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <filesystem>
+
+#include <Siv3D.hpp> // OpenSiv3D v0.3.0
+//描画・入力は使わないが、String・FilePath・シリアライズ・TCP・DirectoryWatcher などは Siv3D のものをそのまま使う
+//そのため Siv3D なしではビルドできず、実行にも Siv3D のランタイム(ウィンドウを開く)が要る
+//OpenSiv3D v0.3 は Windows 版だけなので、このヘッダーを使うもの(Benchmark.cpp を含む)は Windows でビルドする
+
+//色の変換は SSE2 が使える環境ではまとめて 4 成分ずつ行う
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && 2 <= _M_IX86_FP)
+#define PMT_SSE2_ENABLED 1
+#include <emmintrin.h>
+#else
+#define PMT_SSE2_ENABLED 0
+#endif
+
+#ifndef PMT_RELEASE_FLAG
+#define PMT_RELEASE_FLAG false
+#endif
+
+//エディタとゲームの通信に使うポート(同じマシンで別の組を動かす場合は include の前に定義する)
+#ifndef PMT_PORT_NUMBER
+#define PMT_PORT_NUMBER 52823
+#endif
+
+//リリースビルドでは PMT_BAKED_HEADER にエディタで書き出したヘッダーを定義する(例: #define PMT_BAKED_HEADER "BakedParameters.hpp")
+//定義すると通信もファイルの読み込みも行わず、書き出した時点の値を返す
+
+//同一マシン上ではメモリマップしたリングバッファで通信する
+#ifndef PMT_SHARED_MEMORY_FLAG
+#define PMT_SHARED_MEMORY_FLAG true
+#endif
+
+namespace pmt
+{
+	//pmt::GetRange で扱う数値の範囲
+	struct ValueRange
+	{
+		template <class Archive>
+		void SIV3D_SERIALIZE(Archive& archive)
+		{
+			archive(min, max);
+		}
+
+		bool operator==(const ValueRange& other)const
+		{
+			return min == other.min && max == other.max;
+		}
+
+		double min = 0.0;
+		double max = 1.0;
+	};
+
+	//キーフレームから次のキーフレームまでの補間のしかた
+	enum class AnimationEasing : uint8 { Linear, EaseIn, EaseOut, EaseInOut, Step };
+
+	//pmt::GetAnimatedColor で扱うキーフレーム 1 つ分
+	struct ColorKeyframe
+	{
+		template <class Archive>
+		void SIV3D_SERIALIZE(Archive& archive)
+		{
+			archive(time, color, easing);
+		}
+
+		bool operator==(const ColorKeyframe& other)const
+		{
+			return time == other.time && color == other.color && easing == other.easing;
+		}
+
+		double time = 0.0;
+		ColorF color = ColorF(1.0);
+		AnimationEasing easing = AnimationEasing::Linear;
+	};
+
+	//時間で変わる色(keys は time の昇順, loop なら duration 秒ごとに繰り返す)
+	//最初のキーより前は最初の色、最後のキーより後は最後の色のまま
+	struct ColorAnimation
+	{
+		template <class Archive>
+		void SIV3D_SERIALIZE(Archive& archive)
+		{
+			archive(keys, duration, loop);
+		}
+
+		bool operator==(const ColorAnimation& other)const
+		{
+			return keys == other.keys && duration == other.duration && loop == other.loop;
+		}
+
+		Array<ColorKeyframe> keys;
+		double duration = 1.0;
+		bool loop = true;
+	};
+
+	namespace detailImpl
+	{
+		static constexpr uint16 PortNumber = PMT_PORT_NUMBER;
+		static constexpr unsigned EditorVersion = 8;
+
+		//初期化に失敗した時などの状態の通知先
+		//既定では何もしない(ParamEditor.hpp を使う場合はウィンドウのタイトルに出す)
+		using StatusHandler = std::function<void(const String&)>;
+
+		inline StatusHandler& GetStatusHandler()
+		{
+			static StatusHandler handler;
+			return handler;
+		}
+
+		inline void ReportStatus(const String& status)
+		{
+			if (const auto& handler = GetStatusHandler())
+			{
+				handler(status);
+			}
+		}
+
+		//pmt::Subscribe で渡す、値が変わった名前の通知先
+		using ChangeHandler = std::function<void(const String&)>;
+
+		//パラメータとして扱える型
+		//名前は型をまたいで一意にすること(エディタは名前で行を区別する)
+		enum class ParameterType : uint8 { Color, Float, Int, Bool, Vec2, Range, Animation };
+		static constexpr size_t ParameterTypeCount = 7;
+
+		//型ごとの情報
+		//DataType: エディタ・通信の中間表現で使う型, Index: 型ごとの配列の添字
+		template <class Type>
+		struct ParameterTraits;
+
+		template <>
+		struct ParameterTraits<Color>
+		{
+			using DataType = ColorF;
+			static constexpr ParameterType Kind = ParameterType::Color;
+			static constexpr size_t Index = 0;
+			static Color Default() { return RandomColor(); }
+		};
+
+		template <>
+		struct ParameterTraits<double>
+		{
+			using DataType = double;
+			static constexpr ParameterType Kind = ParameterType::Float;
+			static constexpr size_t Index = 1;
+			static double Default() { return 0.0; }
+		};
+
+		template <>
+		struct ParameterTraits<int32>
+		{
+			using DataType = int32;
+			static constexpr ParameterType Kind = ParameterType::Int;
+			static constexpr size_t Index = 2;
+			static int32 Default() { return 0; }
+		};
+
+		template <>
+		struct ParameterTraits<bool>
+		{
+			using DataType = bool;
+			static constexpr ParameterType Kind = ParameterType::Bool;
+			static constexpr size_t Index = 3;
+			static bool Default() { return false; }
+		};
+
+		template <>
+		struct ParameterTraits<Vec2>
+		{
+			using DataType = Vec2;
+			static constexpr ParameterType Kind = ParameterType::Vec2;
+			static constexpr size_t Index = 4;
+			static Vec2 Default() { return Vec2(0.0, 0.0); }
+		};
+
+		template <>
+		struct ParameterTraits<ValueRange>
+		{
+			using DataType = ValueRange;
+			static constexpr ParameterType Kind = ParameterType::Range;
+			static constexpr size_t Index = 5;
+			static ValueRange Default() { return ValueRange(); }
+		};
+
+		template <>
+		struct ParameterTraits<ColorAnimation>
+		{
+			using DataType = ColorAnimation;
+			static constexpr ParameterType Kind = ParameterType::Animation;
+			static constexpr size_t Index = 6;
+
+			//ランダムな色でゆっくり明滅する
+			static ColorAnimation Default()
+			{
+				const double hue = Random(360.0);
+				ColorAnimation animation;
+				animation.keys.push_back({ 0.0, HSV(hue, 0.5, 1.0).toColorF(), AnimationEasing::EaseInOut });
+				animation.keys.push_back({ 0.5, HSV(hue, 0.5, 0.5).toColorF(), AnimationEasing::EaseInOut });
+				animation.keys.push_back({ 1.0, HSV(hue, 0.5, 1.0).toColorF(), AnimationEasing::EaseInOut });
+				return animation;
+			}
+		};
+
+		template <class Type>
+		struct TypeTag
+		{
+			using type = Type;
+		};
+
+		//扱える型それぞれについて f(TypeTag<Type>()) を呼ぶ
+		template <class Function>
+		inline void ForEachParameterType(Function f)
+		{
+			f(TypeTag<Color>());
+			f(TypeTag<double>());
+			f(TypeTag<int32>());
+			f(TypeTag<bool>());
+			f(TypeTag<Vec2>());
+			f(TypeTag<ValueRange>());
+			f(TypeTag<ColorAnimation>());
+		}
+
+		struct ParameterData
+		{
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				archive(colors, floats, ints, bools, vec2s, ranges, animations);
+			}
+
+			template <class Type>
+			std::unordered_map<String, typename ParameterTraits<Type>::DataType>& get()
+			{
+				return std::get<ParameterTraits<Type>::Index>(std::tie(colors, floats, ints, bools, vec2s, ranges, animations));
+			}
+
+			template <class Type>
+			const std::unordered_map<String, typename ParameterTraits<Type>::DataType>& get()const
+			{
+				return std::get<ParameterTraits<Type>::Index>(std::tie(colors, floats, ints, bools, vec2s, ranges, animations));
+			}
+
+			bool empty()const
+			{
+				return colors.empty() && floats.empty() && ints.empty() && bools.empty() && vec2s.empty() && ranges.empty() && animations.empty();
+			}
+
+			//同じ名前は other の値で上書きする
+			void merge(const ParameterData& other)
+			{
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					for (const auto& keyVal : other.get<Type>())
+					{
+						get<Type>()[keyVal.first] = keyVal.second;
+					}
+				});
+			}
+
+			//last と同じ値の名前を取り除き、残った値を last に反映する
+			void removeUnchanged(ParameterData& last)
+			{
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					auto& values = get<Type>();
+					auto& lastValues = last.get<Type>();
+					for (auto it = values.begin(); it != values.end();)
+					{
+						const auto lastIt = lastValues.find(it->first);
+						if (lastIt != lastValues.end() && lastIt->second == it->second)
+						{
+							it = values.erase(it);
+						}
+						else
+						{
+							lastValues[it->first] = it->second;
+							++it;
+						}
+					}
+				});
+			}
+
+			std::unordered_map<String, ColorF> colors;
+			std::unordered_map<String, double> floats;
+			std::unordered_map<String, int32> ints;
+			std::unordered_map<String, bool> bools;
+			std::unordered_map<String, Vec2> vec2s;
+			std::unordered_map<String, ValueRange> ranges;
+			std::unordered_map<String, ColorAnimation> animations;
+		};
+
+		//通信用の差分形式
+		//名前と ID の対応はセッション中に一度だけ送り、以降は (ID, 通し番号, 値) だけを送る
+		struct ParameterBinding
+		{
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				archive(id, type, name);
+			}
+
+			uint32 id = 0;
+			ParameterType type = ParameterType::Color;
+			String name;
+		};
+
+		template <class Type>
+		struct ParameterUpdate
+		{
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				archive(id, sequence, value);
+			}
+
+			uint32 id = 0;
+			uint32 sequence = 0;
+			Type value;
+		};
+
+		//ColorF の配列を Color の配列に変換する([0, 1] に丸めてから 255 倍して四捨五入する, NaN は 0)
+		inline void ConvertColors(const ColorF* source, Color* destination, size_t count)
+		{
+#if PMT_SSE2_ENABLED
+			const __m128d zero = _mm_setzero_pd();
+			const __m128d one = _mm_set1_pd(1.0);
+			const __m128d scale = _mm_set1_pd(255.0);
+			const __m128d half = _mm_set1_pd(0.5);
+			for (size_t n = 0; n < count; ++n)
+			{
+				//_mm_max_pd は片方が NaN なら 2 つ目の引数(0)を返す
+				const double* rgba = &source[n].r;
+				const __m128d rg = _mm_add_pd(_mm_mul_pd(_mm_min_pd(_mm_max_pd(_mm_loadu_pd(rgba), zero), one), scale), half);
+				const __m128d ba = _mm_add_pd(_mm_mul_pd(_mm_min_pd(_mm_max_pd(_mm_loadu_pd(rgba + 2), zero), one), scale), half);
+
+				const __m128i rgba32 = _mm_unpacklo_epi64(_mm_cvttpd_epi32(rg), _mm_cvttpd_epi32(ba));
+				const __m128i rgba16 = _mm_packs_epi32(rgba32, rgba32);
+				const __m128i rgba8 = _mm_packus_epi16(rgba16, rgba16);
+
+				const uint32 packed = static_cast<uint32>(_mm_cvtsi128_si32(rgba8));
+				std::memcpy(&destination[n], &packed, sizeof(packed));
+			}
+#else
+			const auto toByte = [](double value)
+			{
+				return static_cast<uint8>((value > 0.0 ? (value < 1.0 ? value : 1.0) : 0.0) * 255.0 + 0.5);
+			};
+			for (size_t n = 0; n < count; ++n)
+			{
+				destination[n] = Color(toByte(source[n].r), toByte(source[n].g), toByte(source[n].b), toByte(source[n].a));
+			}
+#endif
+		}
+
+		//Color の配列を ColorF の配列に変換する
+		inline void ConvertColors(const Color* source, ColorF* destination, size_t count)
+		{
+#if PMT_SSE2_ENABLED
+			const __m128i zero = _mm_setzero_si128();
+			const __m128d scale = _mm_set1_pd(255.0);
+			for (size_t n = 0; n < count; ++n)
+			{
+				uint32 packed;
+				std::memcpy(&packed, &source[n], sizeof(packed));
+
+				const __m128i rgba16 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(packed)), zero);
+				const __m128i rgba32 = _mm_unpacklo_epi16(rgba16, zero);
+				const __m128d rg = _mm_div_pd(_mm_cvtepi32_pd(rgba32), scale);
+				const __m128d ba = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(rgba32, 8)), scale);
+
+				_mm_storeu_pd(&destination[n].r, rg);
+				_mm_storeu_pd(&destination[n].b, ba);
+			}
+#else
+			for (size_t n = 0; n < count; ++n)
+			{
+				destination[n] = ColorF(source[n]);
+			}
+#endif
+		}
+
+		//編集から反映までの時間の計測に使う時刻
+		//同じマシン上のプロセス間で比べられるように steady_clock のマイクロ秒で持つ
+		inline int64 TraceClock()
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		//エディタでの変更 1 件がゲームで読まれるまでの各段階の時刻(TraceClock, 0 は未計測)
+		//editedAt: エディタで変更した, sentAt: エディタの通信スレッドが送った
+		//receivedAt: ゲームの通信スレッドが受け取った, appliedAt: pmt::Update で反映された, readAt: ゲームが初めて値を取得した
+		struct LatencyTrace
+		{
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				archive(editedAt, sentAt, receivedAt, appliedAt, readAt);
+			}
+
+			int64 editedAt = 0;
+			int64 sentAt = 0;
+			int64 receivedAt = 0;
+			int64 appliedAt = 0;
+			int64 readAt = 0;
+		};
+
+		struct ParameterMessage
+		{
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				archive(bindings, colorUpdates, floatUpdates, intUpdates, boolUpdates, vec2Updates, rangeUpdates, animationUpdates, editedAt, sentAt, latencies);
+			}
+
+			template <class Type>
+			Array<ParameterUpdate<Type>>& updates()
+			{
+				return std::get<ParameterTraits<Type>::Index>(std::tie(colorUpdates, floatUpdates, intUpdates, boolUpdates, vec2Updates, rangeUpdates, animationUpdates));
+			}
+
+			template <class Type>
+			const Array<ParameterUpdate<Type>>& updates()const
+			{
+				return std::get<ParameterTraits<Type>::Index>(std::tie(colorUpdates, floatUpdates, intUpdates, boolUpdates, vec2Updates, rangeUpdates, animationUpdates));
+			}
+
+			bool empty()const
+			{
+				return bindings.empty() && colorUpdates.empty() && floatUpdates.empty() && intUpdates.empty()
+					&& boolUpdates.empty() && vec2Updates.empty() && rangeUpdates.empty() && animationUpdates.empty();
+			}
+
+			Array<ParameterBinding> bindings;
+			Array<ParameterUpdate<Color>> colorUpdates;
+			Array<ParameterUpdate<double>> floatUpdates;
+			Array<ParameterUpdate<int32>> intUpdates;
+			Array<ParameterUpdate<bool>> boolUpdates;
+			Array<ParameterUpdate<Vec2>> vec2Updates;
+			Array<ParameterUpdate<ValueRange>> rangeUpdates;
+			Array<ParameterUpdate<ColorAnimation>> animationUpdates;
+
+			//エディタ→ゲーム: このメッセージに含まれる最も古い変更の時刻と送信した時刻
+			int64 editedAt = 0;
+			int64 sentAt = 0;
+
+			//ゲーム→エディタ: 計測し終えた変更
+			Array<LatencyTrace> latencies;
+		};
+
+		//送信側: ParameterData を差分メッセージにする
+		//名前と ID の対応はセッションごとのものなので、エンコーダ・デコーダはセッションごとに作る(ClientSession と共に作り直される)
+		class ParameterEncoder
+		{
+		public:
+			//初めて送る名前には ID を割り当て、同じメッセージに対応を載せる
+			ParameterMessage encode(const ParameterData& data)
+			{
+				ParameterMessage message;
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					auto& typeIds = ids[ParameterTraits<Type>::Index];
+					for (const auto& keyVal : data.get<Type>())
+					{
+						auto it = typeIds.find(keyVal.first);
+						if (it == typeIds.end())
+						{
+							ParameterBinding binding;
+							binding.id = nextId++;
+							binding.type = ParameterTraits<Type>::Kind;
+							binding.name = keyVal.first;
+							it = typeIds.emplace(keyVal.first, binding.id).first;
+							message.bindings.push_back(binding);
+						}
+
+						ParameterUpdate<Type> update;
+						update.id = it->second;
+						update.sequence = ++sequence;
+						update.value = Type(keyVal.second);
+						message.updates<Type>().push_back(update);
+					}
+				});
+
+				return message;
+			}
+
+		private:
+			std::array<std::unordered_map<String, uint32>, ParameterTypeCount> ids;
+			uint32 nextId = 0;
+			uint32 sequence = 0;
+		};
+
+		//受信側: 差分メッセージを ParameterData に戻す
+		class ParameterDecoder
+		{
+		public:
+			//既に受け取った更新より古いもの・重複したもの・型が食い違うものは捨てる
+			void decode(const ParameterMessage& message, ParameterData& result)
+			{
+				for (const auto& binding : message.bindings)
+				{
+					if (names.size() <= binding.id)
+					{
+						names.resize(binding.id + 1);
+						types.resize(binding.id + 1, ParameterType::Color);
+						lastSequences.resize(binding.id + 1, 0);
+					}
+					names[binding.id] = binding.name;
+					types[binding.id] = binding.type;
+				}
+
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					for (const auto& update : message.updates<Type>())
+					{
+						if (names.size() <= update.id
+							|| types[update.id] != ParameterTraits<Type>::Kind
+							|| update.sequence <= lastSequences[update.id])
+						{
+							continue;
+						}
+
+						lastSequences[update.id] = update.sequence;
+						result.get<Type>()[names[update.id]] = update.value;
+					}
+				});
+			}
+
+			//メッセージの最初の更新の型と名前(計測の対象にする値を決めるのに使う, decode の後に呼ぶ)
+			Optional<std::pair<ParameterType, String>> getFirstParameter(const ParameterMessage& message)const
+			{
+				Optional<std::pair<ParameterType, String>> result;
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					const auto& updates = message.updates<Type>();
+					if (!result && !updates.empty() && updates.front().id < names.size())
+					{
+						result = std::make_pair(ParameterTraits<Type>::Kind, names[updates.front().id]);
+					}
+				});
+				return result;
+			}
+
+		private:
+			std::vector<String> names;
+			std::vector<ParameterType> types;
+			std::vector<uint32> lastSequences;
+		};
+
+		//ハンドシェイク後の通信はソケット上で ParameterMessage をフレームとして送る
+		//フレームの形式: [ペイロード長 (uint32)][Serializer<MemoryWriter> で書き出した ParameterMessage]
+		inline Array<Byte> EncodeFrame(const ParameterMessage& message)
+		{
+			Serializer<MemoryWriter> serializer;
+			serializer(message);
+			const auto& writer = serializer.getWriter();
+
+			const uint32 payloadSize = static_cast<uint32>(writer.size());
+			Array<Byte> frame(sizeof(payloadSize) + payloadSize);
+			std::memcpy(frame.data(), &payloadSize, sizeof(payloadSize));
+			std::memcpy(frame.data() + sizeof(payloadSize), writer.data(), payloadSize);
+			return frame;
+		}
+
+		//受信済みのバイト列からフレームを 1 つ取り出す(まだ揃っていなければ false)
+		//Socket は TCPClient か TCPServer (sessionID はサーバーの場合のみ)
+		template <class Socket, class... SessionID>
+		bool ReceiveFrame(Socket& socket, ParameterMessage& message, const SessionID&... sessionID)
+		{
+			uint32 payloadSize = 0;
+			if (socket.available(sessionID...) < sizeof(payloadSize) || !socket.lookahead(payloadSize, sessionID...))
+			{
+				return false;
+			}
+
+			if (socket.available(sessionID...) < sizeof(payloadSize) + payloadSize)
+			{
+				return false;
+			}
+
+			Array<Byte> frame(sizeof(payloadSize) + payloadSize);
+			if (!socket.read(frame.data(), frame.size(), sessionID...))
+			{
+				return false;
+			}
+
+			Deserializer<ByteArray> deserializer(frame.data() + sizeof(payloadSize), payloadSize);
+			deserializer(message);
+			return true;
+		}
+
+		//ParameterEditor ディレクトリ内のファイルをメモリマップした単一生産者・単一消費者のリングバッファ
+		//EncodeFrame の形式のフレームを読み書きし、定常状態ではシステムコールを発行しない
+		//クライアント視点で send.ring (クライアント→サーバー) と receive.ring (サーバー→クライアント) の 2 本を使う
+		//フレームは [長さ (uint32, 最上位ビットはフレームの最後の断片か)][バイト列] の断片に分けて書くので、容量より大きなフレームも順序を保って送れる
+		class SharedRingBuffer
+		{
+		public:
+			static constexpr uint32 Capacity = 1 << 16;
+
+			//空のリングバッファのファイルを作る(既にあれば中身を捨てる)
+			static void Create(const FilePath& path)
+			{
+				const Array<Byte> zero(sizeof(Header) + Capacity);
+				BinaryWriter writer(path);
+				writer.write(zero.data(), zero.size());
+			}
+
+			bool open(const FilePath& path)
+			{
+				mapping = std::make_unique<WritableMemoryMapping>(path);
+				mapping->map(0, sizeof(Header) + Capacity);
+
+				if (!mapping->data() || mapping->size() < sizeof(Header) + Capacity)
+				{
+					mapping.reset();
+					return false;
+				}
+
+				return true;
+			}
+
+			bool isOpen()const
+			{
+				return static_cast<bool>(mapping);
+			}
+
+			//フレームを受け取ったら true を返す(空きが足りない分は内部に残し、以降の push / flush で書き足す)
+			//前のフレームをまだ書き終えていなければ、それを書き足すだけで frame は受け取らない
+			bool push(const Array<Byte>& frame)
+			{
+				if (!mapping || !flush())
+				{
+					return false;
+				}
+
+				pushing = frame;
+				pushingOffset = 0;
+				flush();
+				return true;
+			}
+
+			//書きかけのフレームを書けるだけ書く(書き終えていれば true)
+			bool flush()
+			{
+				if (!mapping)
+				{
+					return false;
+				}
+
+				Header& header = getHeader();
+				while (pushingOffset < pushing.size())
+				{
+					const uint32 writePos = header.writePos.load(std::memory_order_relaxed);
+					const uint32 readPos = header.readPos.load(std::memory_order_acquire);
+					const uint32 space = Capacity - (writePos - readPos);
+					if (space <= sizeof(uint32))
+					{
+						return false;
+					}
+
+					const uint32 chunkSize = static_cast<uint32>(std::min<size_t>(pushing.size() - pushingOffset, space - sizeof(uint32)));
+					const bool last = (pushingOffset + chunkSize == pushing.size());
+					const uint32 chunkHeader = chunkSize | (last ? LastChunkFlag : 0);
+
+					copyIn(writePos, &chunkHeader, sizeof(chunkHeader));
+					copyIn(writePos + sizeof(chunkHeader), pushing.data() + pushingOffset, chunkSize);
+					header.writePos.store(writePos + sizeof(chunkHeader) + chunkSize, std::memory_order_release);
+					pushingOffset += chunkSize;
+				}
+
+				pushing.clear();
+				pushingOffset = 0;
+				return true;
+			}
+
+			//フレームが揃っていなければ false を返す
+			//壊れた断片を見つけたら、それまでに書かれた分を捨てて読み直せる状態に戻す
+			bool pop(ParameterMessage& message)
+			{
+				if (!mapping)
+				{
+					return false;
+				}
+
+				Header& header = getHeader();
+				for (;;)
+				{
+					const uint32 readPos = header.readPos.load(std::memory_order_relaxed);
+					const uint32 writePos = header.writePos.load(std::memory_order_acquire);
+					const uint32 available = writePos - readPos;
+
+					//生産者は断片全体を書き終えてから writePos を進めるので、途中までしか無いことはない
+					uint32 chunkHeader = 0;
+					if (available < sizeof(chunkHeader))
+					{
+						return false;
+					}
+					copyOut(readPos, &chunkHeader, sizeof(chunkHeader));
+
+					const uint32 chunkSize = chunkHeader & ~LastChunkFlag;
+					if (Capacity < available || available - sizeof(chunkHeader) < chunkSize)
+					{
+						reset(writePos);
+						return false;
+					}
+
+					const size_t offset = popping.size();
+					popping.resize(offset + chunkSize);
+					copyOut(readPos + sizeof(chunkHeader), popping.data() + offset, chunkSize);
+					header.readPos.store(readPos + sizeof(chunkHeader) + chunkSize, std::memory_order_release);
+
+					if (!(chunkHeader & LastChunkFlag))
+					{
+						continue;
+					}
+
+					Array<Byte> frame;
+					frame.swap(popping);
+
+					uint32 payloadSize = 0;
+					if (frame.size() < sizeof(payloadSize))
+					{
+						reset(writePos);
+						return false;
+					}
+					std::memcpy(&payloadSize, frame.data(), sizeof(payloadSize));
+					if (frame.size() - sizeof(payloadSize) != payloadSize)
+					{
+						reset(writePos);
+						return false;
+					}
+
+					try
+					{
+						Deserializer<ByteArray> deserializer(frame.data() + sizeof(payloadSize), payloadSize);
+						deserializer(message);
+					}
+					catch (std::exception& e)
+					{
+						Logger << Unicode::Widen(e.what());
+						continue;
+					}
+					return true;
+				}
+			}
+
+		private:
+			//読み書きの位置はプロセス間で共有するので別のキャッシュラインに置く
+			struct Header
+			{
+				alignas(64) std::atomic<uint32> writePos;
+				alignas(64) std::atomic<uint32> readPos;
+			};
+
+			static constexpr uint32 LastChunkFlag = 0x80000000u;
+
+			static_assert(std::atomic<uint32>::is_always_lock_free, "SharedRingBuffer requires lock-free atomics");
+			static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+			static_assert(Capacity < LastChunkFlag, "Capacity must fit in a chunk header");
+
+			Header& getHeader()
+			{
+				return *reinterpret_cast<Header*>(mapping->data());
+			}
+
+			Byte* getBuffer()
+			{
+				return mapping->data() + sizeof(Header);
+			}
+
+			//消費者側から、読みかけのフレームと writePos までに書かれた分を捨てる
+			void reset(uint32 writePos)
+			{
+				Logger << U"SharedRingBuffer: 壊れたフレームを捨てました";
+				popping.clear();
+				getHeader().readPos.store(writePos, std::memory_order_release);
+			}
+
+			void copyIn(uint32 pos, const void* src, size_t size)
+			{
+				const uint32 offset = pos & (Capacity - 1);
+				const size_t first = std::min<size_t>(size, Capacity - offset);
+				std::memcpy(getBuffer() + offset, src, first);
+				std::memcpy(getBuffer(), static_cast<const Byte*>(src) + first, size - first);
+			}
+
+			void copyOut(uint32 pos, void* dst, size_t size)
+			{
+				const uint32 offset = pos & (Capacity - 1);
+				const size_t first = std::min<size_t>(size, Capacity - offset);
+				std::memcpy(dst, getBuffer() + offset, first);
+				std::memcpy(static_cast<Byte*>(dst) + first, getBuffer(), size - first);
+			}
+
+			std::unique_ptr<WritableMemoryMapping> mapping;
+
+			//生産者側の書きかけのフレーム
+			Array<Byte> pushing;
+			size_t pushingOffset = 0;
+			//消費者側の読みかけのフレーム
+			Array<Byte> popping;
+		};
+
+		//ハンドシェイクでクライアントが送るもの: [ParameterEditor ディレクトリのフルパス (char32_t × 256)][クライアントの番号 (uint64)]
+		static constexpr size_t HandshakeSize = sizeof(char32_t) * 256 + sizeof(uint64);
+
+		//同じディレクトリを使うゲームを同時に起動しても重ならないクライアントの番号
+		inline uint64 NewClientID()
+		{
+			std::random_device device;
+			const uint64 random = (static_cast<uint64>(device()) << 32) | device();
+			return random ^ static_cast<uint64>(std::chrono::steady_clock::now().time_since_epoch().count());
+		}
+
+		//クライアントごとの通信用のファイル(send.dat / receive.dat / send.ring / receive.ring)を置くディレクトリ
+		//セーブデータ(save.dat / journal.dat)は ParameterEditor ディレクトリに置いたまま共有する
+		inline FilePath ClientDirectoryPath(const FilePath& directoryPath, uint64 clientID)
+		{
+			return directoryPath + U"clients/" + ToHex(clientID) + U"/";
+		}
+
+		//MessageChannel から見たソケット(ゲーム側の接続)
+		struct ClientSocket
+		{
+			TCPClient& client;
+
+			bool isConnected()
+			{
+				return client.isConnected();
+			}
+
+			bool send(const Array<Byte>& frame)
+			{
+				return client.send(frame.data(), frame.size());
+			}
+
+			bool receive(ParameterMessage& message)
+			{
+				return ReceiveFrame(client, message);
+			}
+		};
+
+		//MessageChannel から見たソケット(エディタ側のクライアント 1 つ分のセッション)
+		struct SessionSocket
+		{
+			TCPServer& server;
+			TCPSessionID id;
+
+			bool isConnected()
+			{
+				return server.hasSession(id);
+			}
+
+			bool send(const Array<Byte>& frame)
+			{
+				return server.send(frame.data(), frame.size(), id);
+			}
+
+			bool receive(ParameterMessage& message)
+			{
+				return ReceiveFrame(server, message, id);
+			}
+		};
+
+		//ハンドシェイク後のメッセージの送受信(エディタはクライアントごとに、ゲームは 1 つ持つ)
+		//リングバッファ > TCP 接続 > ファイル(ソケットが切れた後のフォールバック)の優先順で使う
+		class MessageChannel
+		{
+		public:
+			//フォールバックに使うファイルと、その変更を監視するディレクトリ
+			void setFiles(const FilePath& directoryPath, const FilePath& newSendFilePath, const FilePath& newReceiveFilePath)
+			{
+				sendFilePath = newSendFilePath;
+				receiveFilePath = newReceiveFilePath;
+				directoryWatcher = DirectoryWatcher(directoryPath);
+			}
+
+			bool openRings(const FilePath& sendRingPath, const FilePath& receiveRingPath)
+			{
+				return sendRing.open(sendRingPath) && receiveRing.open(receiveRingPath);
+			}
+
+			//届いたメッセージを順に onMessage(message) に渡す
+			template <class Socket, class Function>
+			void receive(Socket socket, Function onMessage)
+			{
+				ParameterMessage message;
+				while (receiveRing.pop(message))
+				{
+					onMessage(message);
+				}
+
+				while (socket.isConnected() && socket.receive(message))
+				{
+					onMessage(message);
+				}
+
+				for (const auto& pathAction : directoryWatcher.retrieveChanges())
+				{
+					if (pathAction.first == receiveFilePath && !FileSystem::IsEmpty(receiveFilePath))
+					{
+						try
+						{
+							Deserializer<BinaryReader> deserializer(receiveFilePath);
+							deserializer(message);
+							onMessage(message);
+						}
+						catch (std::exception& e)
+						{
+							Logger << Unicode::Widen(e.what());
+						}
+
+						BinaryWriter writer(receiveFilePath);
+					}
+				}
+			}
+
+			//送れたら true を返す
+			//一度エンコードしたメッセージは、呼び出し側で送れるまで保持して送り直す(ID の対応を送り損ねないため)
+			template <class Socket>
+			bool send(Socket socket, const ParameterMessage& message)
+			{
+				//リングバッファが使える間はそれだけを使う(TCP と混ぜると受信側で順序が入れ替わる)
+				if (sendRing.isOpen())
+				{
+					return sendRing.push(EncodeFrame(message));
+				}
+
+				if (socket.isConnected() && socket.send(EncodeFrame(message)))
+				{
+					return true;
+				}
+
+				if (!FileSystem::IsEmpty(sendFilePath))
+				{
+					return false;
+				}
+
+				try
+				{
+					Serializer<BinaryWriter> serializer(sendFilePath);
+					serializer(message);
+					return true;
+				}
+				catch (std::exception& e)
+				{
+					Logger << Unicode::Widen(e.what());
+					return false;
+				}
+			}
+
+			//書きかけのフレームは新しいメッセージが無くても書き足す(書き終えていれば true)
+			bool flush()
+			{
+				return !sendRing.isOpen() || sendRing.flush();
+			}
+
+		private:
+			FilePath sendFilePath;
+			FilePath receiveFilePath;
+			DirectoryWatcher directoryWatcher;
+			SharedRingBuffer sendRing;
+			SharedRingBuffer receiveRing;
+		};
+
+		//pmt::Register で得られるパラメータのハンドル
+		//値を取得する度に名前をハッシュせず、型ごとの配列の添字で値を引く
+		template <class Type>
+		struct Param
+		{
+			uint32 index = 0;
+			Param() = default;
+			explicit Param(uint32 index) :
+				index(index)
+			{}
+		};
+
+		using ColorParam = Param<Color>;
+		using FloatParam = Param<double>;
+		using IntParam = Param<int32>;
+		using BoolParam = Param<bool>;
+		using Vec2Param = Param<Vec2>;
+		using RangeParam = Param<ValueRange>;
+		using AnimatedColorParam = Param<ColorAnimation>;
+
+		//ハンドルの配列から値を集める(Color はそのまま、ColorF は一定数ずつ集めてからまとめて変換する)
+		//getBlock(params, count, colors) はハンドル count 個分の Color を colors に書き出す
+		template <class GetBlock>
+		void GatherColors(const Param<Color>* params, size_t count, Color* results, GetBlock getBlock)
+		{
+			getBlock(params, count, results);
+		}
+
+		template <class GetBlock>
+		void GatherColors(const Param<Color>* params, size_t count, ColorF* results, GetBlock getBlock)
+		{
+			constexpr size_t BlockSize = 64;
+			std::array<Color, BlockSize> block;
+			for (size_t offset = 0; offset < count; offset += BlockSize)
+			{
+				const size_t blockCount = std::min(BlockSize, count - offset);
+				getBlock(params + offset, blockCount, block.data());
+				ConvertColors(block.data(), results + offset, blockCount);
+			}
+		}
+
+		//BakedHeader が書き出すヘッダーの 1 件分
+		template <class Type>
+		struct BakedEntry
+		{
+			const char32_t* name;
+			Type value;
+		};
+
+		//ColorAnimation はキーフレームを 1 本の配列にまとめ、その範囲を持つ
+		struct BakedKeyframe
+		{
+			double time;
+			double r;
+			double g;
+			double b;
+			double a;
+			AnimationEasing easing;
+		};
+
+		struct BakedAnimation
+		{
+			uint32 firstKey;
+			uint32 keyCount;
+			double duration;
+			bool loop;
+		};
+
+		//クライアント側の値の置き場所(型ごとに連続した配列を持ち、ハンドルの index で引く)
+		template <class Type>
+		struct ParameterStorage
+		{
+			std::unordered_map<String, uint32> indices;
+			std::vector<Type> values;
+		};
+
+		//階層付きの名前("player/body/tint" のように '/' で区切る)の索引
+		//区切りごとに節を持つトライ木で、前方一致の列挙・購読・リセットは部分木の大きさに比例する時間で済む
+		//前方一致は区切り単位で判定する("ui/hud" は "ui/hud/life" に一致し、"ui/hudson" には一致しない)
+		class ParameterTree
+		{
+		public:
+			static constexpr char32 Separator = U'/';
+			static constexpr uint32 Root = 0;
+
+			struct Entry
+			{
+				String name;
+				ParameterType type = ParameterType::Color;
+				uint32 index = 0;
+			};
+
+			struct Node
+			{
+				String label;
+				uint32 parent = Root;
+				uint32 depth = 0;
+				//子の節(名前順に並べておき、列挙と表示の順を安定させる)
+				std::map<String, uint32> children;
+				//この節で終わる名前
+				Array<Entry> entries;
+				//部分木に含まれる名前の数
+				size_t count = 0;
+				//この節を起点にした購読の ID
+				Array<uint32> subscriptions;
+			};
+
+			ParameterTree()
+			{
+				clear();
+			}
+
+			void clear()
+			{
+				nodes.clear();
+				nodes.emplace_back();
+			}
+
+			//名前を加えて、名前が終わる節を返す
+			uint32 insert(const String& name, ParameterType type, uint32 index)
+			{
+				const uint32 node = touch(name);
+				nodes[node].entries.push_back(Entry{ name, type, index });
+				for (uint32 n = node; ; n = nodes[n].parent)
+				{
+					++nodes[n].count;
+					if (n == Root)
+					{
+						break;
+					}
+				}
+				return node;
+			}
+
+			//prefix の節を返す(無ければ途中の節ごと作る, 空文字列は根)
+			uint32 touch(const String& prefix)
+			{
+				uint32 node = Root;
+				ForEachSegment(prefix, [&](const String& segment)
+				{
+					const auto it = nodes[node].children.find(segment);
+					if (it != nodes[node].children.end())
+					{
+						node = it->second;
+						return;
+					}
+
+					Node child;
+					child.label = segment;
+					child.parent = node;
+					child.depth = nodes[node].depth + 1;
+
+					const uint32 childIndex = static_cast<uint32>(nodes.size());
+					nodes[node].children.emplace(segment, childIndex);
+					nodes.push_back(std::move(child));
+					node = childIndex;
+				});
+				return node;
+			}
+
+			Optional<uint32> find(const String& prefix)const
+			{
+				Optional<uint32> node = Root;
+				ForEachSegment(prefix, [&](const String& segment)
+				{
+					if (!node)
+					{
+						return;
+					}
+
+					const auto it = nodes[node.value()].children.find(segment);
+					node = (it == nodes[node.value()].children.end()) ? none : Optional<uint32>(it->second);
+				});
+				return node;
+			}
+
+			//node の部分木に含まれる名前を f(entry) に渡す(節ごとに名前順)
+			template <class Function>
+			void forEach(uint32 node, Function f)const
+			{
+				std::vector<uint32> stack = { node };
+				while (!stack.empty())
+				{
+					const Node& current = nodes[stack.back()];
+					stack.pop_back();
+
+					for (const auto& entry : current.entries)
+					{
+						f(entry);
+					}
+					for (auto it = current.children.rbegin(); it != current.children.rend(); ++it)
+					{
+						stack.push_back(it->second);
+					}
+				}
+			}
+
+			//根から name の節までの途中にある節を f(node) に渡す(購読の検索に使う, 深さに比例する)
+			template <class Function>
+			void forEachOnPath(const String& name, Function f)const
+			{
+				Optional<uint32> node = Root;
+				f(Root);
+				ForEachSegment(name, [&](const String& segment)
+				{
+					if (!node)
+					{
+						return;
+					}
+
+					const auto it = nodes[node.value()].children.find(segment);
+					if (it == nodes[node.value()].children.end())
+					{
+						node = none;
+						return;
+					}
+					node = it->second;
+					f(it->second);
+				});
+			}
+
+			Array<String> list(const String& prefix)const
+			{
+				Array<String> names;
+				if (const auto node = find(prefix))
+				{
+					names.reserve(nodes[node.value()].count);
+					forEach(node.value(), [&](const Entry& entry)
+					{
+						names.push_back(entry.name);
+					});
+				}
+				return names;
+			}
+
+			String getPath(uint32 node)const
+			{
+				Array<const String*> labels;
+				for (; node != Root; node = nodes[node].parent)
+				{
+					labels.push_back(&nodes[node].label);
+				}
+
+				String path;
+				for (auto it = labels.rbegin(); it != labels.rend(); ++it)
+				{
+					if (!path.isEmpty())
+					{
+						path.push_back(Separator);
+					}
+					path.append(**it);
+				}
+				return path;
+			}
+
+			const Node& getNode(uint32 node)const
+			{
+				return nodes[node];
+			}
+
+			void addSubscription(uint32 node, uint32 id)
+			{
+				nodes[node].subscriptions.push_back(id);
+			}
+
+			void removeSubscription(uint32 node, uint32 id)
+			{
+				auto& subscriptions = nodes[node].subscriptions;
+				subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), id), subscriptions.end());
+			}
+
+		private:
+			//区切りの間の 1 段ずつを f(segment) に渡す(空の段は飛ばす)
+			template <class Function>
+			static void ForEachSegment(const String& path, Function f)
+			{
+				size_t begin = 0;
+				while (begin <= path.size())
+				{
+					size_t end = path.indexOf(Separator, begin);
+					if (end == String::npos)
+					{
+						end = path.size();
+					}
+
+					if (begin < end)
+					{
+						f(path.substr(begin, end - begin));
+					}
+					begin = end + 1;
+				}
+			}
+
+			std::vector<Node> nodes;
+		};
+
+		//アニメーションする色をまとめて評価する
+		//キーフレームは要素ごとの連続した配列(時刻, r, g, b, a)に並べ直しておき、
+		//毎フレームの評価は「区間と補間係数を求める → 4 成分をまとめて線形補間する → Color に詰める」の単純なループで行う
+		//(後の 2 つは分岐のない連続した配列のループなので、コンパイラの自動ベクトル化が効く)
+		//評価結果は shared_ptr で公開し、読む側はスレッドごとに世代を見て取り直すだけなのでロックしない
+		class AnimationEvaluator
+		{
+		public:
+			//1 つだけ評価する(まとめて評価する前に登録されたものなど)
+			static Color Evaluate(const ColorAnimation& animation, double time)
+			{
+				if (animation.keys.empty())
+				{
+					return Color(255);
+				}
+
+				const double localTime = LocalTime(time, animation.duration, animation.loop);
+				size_t from = 0;
+				while (from + 1 < animation.keys.size() && animation.keys[from + 1].time <= localTime)
+				{
+					++from;
+				}
+
+				const ColorKeyframe& key = animation.keys[from];
+				if (from + 1 == animation.keys.size() || localTime <= key.time)
+				{
+					return key.color.toColor();
+				}
+
+				const ColorKeyframe& next = animation.keys[from + 1];
+				const double weight = Ease(key.easing, (localTime - key.time) / (next.time - key.time));
+				return key.color.lerp(next.color, weight).toColor();
+			}
+
+			//アニメーションの一覧が変わった時だけ呼ぶ(index は Param<ColorAnimation> の index と同じ並び)
+			void build(const std::vector<ColorAnimation>& animations)
+			{
+				firstKeys.clear();
+				keyCounts.clear();
+				durations.clear();
+				loops.clear();
+				keyTimes.clear();
+				keyEasings.clear();
+				for (auto& channel : keyChannels)
+				{
+					channel.clear();
+				}
+
+				for (const auto& animation : animations)
+				{
+					firstKeys.push_back(static_cast<uint32>(keyTimes.size()));
+					keyCounts.push_back(static_cast<uint32>(animation.keys.size()));
+					durations.push_back(animation.duration);
+					loops.push_back(animation.loop);
+
+					for (const auto& key : animation.keys)
+					{
+						keyTimes.push_back(key.time);
+						keyEasings.push_back(key.easing);
+						keyChannels[0].push_back(static_cast<float>(key.color.r));
+						keyChannels[1].push_back(static_cast<float>(key.color.g));
+						keyChannels[2].push_back(static_cast<float>(key.color.b));
+						keyChannels[3].push_back(static_cast<float>(key.color.a));
+					}
+				}
+
+				//キーが無いものは白にする
+				if (std::find(keyCounts.begin(), keyCounts.end(), 0u) != keyCounts.end())
+				{
+					whiteKey = static_cast<uint32>(keyTimes.size());
+					keyTimes.push_back(0.0);
+					keyEasings.push_back(AnimationEasing::Linear);
+					for (auto& channel : keyChannels)
+					{
+						channel.push_back(1.0f);
+					}
+				}
+			}
+
+			//time 秒の時点の色をまとめて求めて公開する(メインスレッドで 1 フレームに 1 回)
+			void evaluate(double time)
+			{
+				const size_t count = firstKeys.size();
+				fromKeys.resize(count);
+				toKeys.resize(count);
+				weights.resize(count);
+
+				//区間と補間係数(アニメーションごとにキーの数が違うのでここだけはスカラー)
+				for (size_t n = 0; n < count; ++n)
+				{
+					if (keyCounts[n] == 0)
+					{
+						fromKeys[n] = toKeys[n] = whiteKey;
+						weights[n] = 0.0f;
+						continue;
+					}
+
+					const double localTime = LocalTime(time, durations[n], loops[n] != 0);
+					const uint32 first = firstKeys[n];
+					const uint32 last = first + keyCounts[n] - 1;
+					uint32 from = first;
+					while (from < last && keyTimes[from + 1] <= localTime)
+					{
+						++from;
+					}
+
+					if (from == last || localTime <= keyTimes[from])
+					{
+						fromKeys[n] = toKeys[n] = from;
+						weights[n] = 0.0f;
+					}
+					else
+					{
+						fromKeys[n] = from;
+						toKeys[n] = from + 1;
+						weights[n] = static_cast<float>(Ease(keyEasings[from], (localTime - keyTimes[from]) / (keyTimes[from + 1] - keyTimes[from])));
+					}
+				}
+
+				//成分ごとに両端の色を集めて補間する
+				for (size_t channel = 0; channel < 4; ++channel)
+				{
+					channels[channel].resize(count);
+					const float* source = keyChannels[channel].data();
+					float* result = channels[channel].data();
+
+					for (size_t n = 0; n < count; ++n)
+					{
+						const float a = source[fromKeys[n]];
+						const float b = source[toKeys[n]];
+						result[n] = a + (b - a) * weights[n];
+					}
+				}
+
+				//Color に詰める
+				auto results = std::make_shared<std::vector<Color>>(count);
+				Color* colors = results->data();
+				const float* r = channels[0].data();
+				const float* g = channels[1].data();
+				const float* b = channels[2].data();
+				const float* a = channels[3].data();
+				for (size_t n = 0; n < count; ++n)
+				{
+					colors[n] = Color(ToByte(r[n]), ToByte(g[n]), ToByte(b[n]), ToByte(a[n]));
+				}
+
+				evaluatedTime.store(time, std::memory_order_relaxed);
+				std::atomic_store(&published, std::shared_ptr<const std::vector<Color>>(std::move(results)));
+				generation.fetch_add(1, std::memory_order_release);
+			}
+
+			//最後にまとめて求めた色(どのスレッドからでも呼べる, 世代が変わらない限りスレッドごとの参照を返すだけ)
+			const std::vector<Color>& current()
+			{
+				struct ThreadCache
+				{
+					const AnimationEvaluator* owner = nullptr;
+					uint64 generation = 0;
+					std::shared_ptr<const std::vector<Color>> colors;
+				};
+
+				thread_local ThreadCache cache;
+				const uint64 currentGeneration = generation.load(std::memory_order_acquire);
+				if (cache.owner != this || cache.generation != currentGeneration)
+				{
+					cache.owner = this;
+					cache.generation = currentGeneration;
+					cache.colors = std::atomic_load(&published);
+				}
+				return *cache.colors;
+			}
+
+			//最後にまとめて評価した時刻
+			double getTime()const
+			{
+				return evaluatedTime.load(std::memory_order_relaxed);
+			}
+
+		private:
+			static double LocalTime(double time, double duration, bool loop)
+			{
+				if (duration <= 0.0)
+				{
+					return 0.0;
+				}
+
+				if (!loop)
+				{
+					return Clamp(time, 0.0, duration);
+				}
+
+				const double localTime = std::fmod(time, duration);
+				return localTime < 0.0 ? localTime + duration : localTime;
+			}
+
+			static double Ease(AnimationEasing easing, double t)
+			{
+				switch (easing)
+				{
+				case AnimationEasing::EaseIn: return t * t;
+				case AnimationEasing::EaseOut: return 1.0 - (1.0 - t) * (1.0 - t);
+				case AnimationEasing::EaseInOut: return t * t * (3.0 - 2.0 * t);
+				case AnimationEasing::Step: return 0.0;
+				default: return t;
+				}
+			}
+
+			static uint8 ToByte(float value)
+			{
+				return static_cast<uint8>(Clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+
+			//アニメーションごと
+			std::vector<uint32> firstKeys;
+			std::vector<uint32> keyCounts;
+			std::vector<double> durations;
+			std::vector<uint8> loops;
+
+			//キーフレームごと(keyChannels は r, g, b, a)
+			std::vector<double> keyTimes;
+			std::vector<AnimationEasing> keyEasings;
+			std::array<std::vector<float>, 4> keyChannels;
+			uint32 whiteKey = 0;
+
+			//評価中の作業用
+			std::vector<uint32> fromKeys;
+			std::vector<uint32> toKeys;
+			std::vector<float> weights;
+			std::array<std::vector<float>, 4> channels;
+
+			std::shared_ptr<const std::vector<Color>> published = std::make_shared<const std::vector<Color>>();
+			std::atomic<uint64> generation{ 0 };
+			std::atomic<double> evaluatedTime{ 0.0 };
+		};
+
+		//MultiColorEditors のうち保存の対象になる部分(値とグループの配置)
+		struct EditorLayout
+		{
+			ParameterData values;
+			std::vector<std::vector<String>> colorGroups;
+			std::vector<Vec2> groupPositions;
+		};
+
+		//構造を共有する配列(Branching 分木で、葉に Branching 件ずつ値を持つ)
+		//コピーは根を共有するだけで、書き換えると根から触れた葉までの節だけが新しくなる(1 件あたり O(log N) 個の節)
+		template <class Type>
+		class PersistentArray
+		{
+		public:
+			static constexpr size_t Bits = 5;
+			static constexpr size_t Branching = size_t(1) << Bits;
+
+			size_t size()const
+			{
+				return count;
+			}
+
+			Type operator[](size_t index)const
+			{
+				const Node* node = root.get();
+				for (size_t level = height; 0 < level; --level)
+				{
+					node = node->children[ChildIndex(index, level)].get();
+				}
+				return node->values[index & Mask];
+			}
+
+			void push_back(const Type& value)
+			{
+				//根が一杯なら一段高くする
+				if (count == size_t(1) << (Bits * (height + 1)))
+				{
+					auto nextRoot = std::make_shared<Node>();
+					nextRoot->children.push_back(std::move(root));
+					root = std::move(nextRoot);
+					++height;
+				}
+
+				root = Pushed(root.get(), height, count, value);
+				++count;
+			}
+
+			//まとめて書き換える(触れた節はそれぞれ 1 回ずつしか複製しない)
+			void assign(const std::vector<std::pair<uint32, Type>>& changes)
+			{
+				if (changes.empty())
+				{
+					return;
+				}
+
+				//同じ添字は後の変更が勝つように、順序を保ったまま添字順に並べる
+				std::vector<const std::pair<uint32, Type>*> sorted;
+				sorted.reserve(changes.size());
+				for (const auto& change : changes)
+				{
+					sorted.push_back(&change);
+				}
+				std::stable_sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+				root = Assigned(*root, height, sorted.data(), sorted.data() + sorted.size());
+			}
+
+		private:
+			static constexpr size_t Mask = Branching - 1;
+
+			//葉(高さ 0)は values を、それ以外は children を使う
+			struct Node
+			{
+				std::vector<std::shared_ptr<const Node>> children;
+				std::vector<Type> values;
+			};
+
+			using ChangePointer = const std::pair<uint32, Type>*;
+
+			static size_t ChildIndex(size_t index, size_t level)
+			{
+				return (index >> (Bits * level)) & Mask;
+			}
+
+			//node(無ければ空の節)の末尾に value を加えた複製を返す
+			static std::shared_ptr<const Node> Pushed(const Node* node, size_t level, size_t index, const Type& value)
+			{
+				auto next = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+				if (level == 0)
+				{
+					next->values.push_back(value);
+					return next;
+				}
+
+				const size_t childIndex = ChildIndex(index, level);
+				if (childIndex < next->children.size())
+				{
+					next->children[childIndex] = Pushed(next->children[childIndex].get(), level - 1, index, value);
+				}
+				else
+				{
+					next->children.push_back(Pushed(nullptr, level - 1, index, value));
+				}
+				return next;
+			}
+
+			//[begin, end) は node の下にある添字順の変更
+			static std::shared_ptr<const Node> Assigned(const Node& node, size_t level, const ChangePointer* begin, const ChangePointer* end)
+			{
+				auto next = std::make_shared<Node>(node);
+				if (level == 0)
+				{
+					for (auto it = begin; it != end; ++it)
+					{
+						next->values[(*it)->first & Mask] = (*it)->second;
+					}
+					return next;
+				}
+
+				while (begin != end)
+				{
+					const size_t childIndex = ChildIndex((*begin)->first, level);
+					const ChangePointer* childEnd = begin;
+					while (childEnd != end && ChildIndex((*childEnd)->first, level) == childIndex)
+					{
+						++childEnd;
+					}
+
+					next->children[childIndex] = Assigned(*next->children[childIndex], level - 1, begin, childEnd);
+					begin = childEnd;
+				}
+				return next;
+			}
+
+			std::shared_ptr<const Node> root = std::make_shared<const Node>();
+			//根の高さ(根が葉なら 0)
+			size_t height = 0;
+			size_t count = 0;
+		};
+
+		//MultiColorEditors の編集履歴(元に戻す・やり直す)
+		//段ごとに全体の状態を持つが、変わっていない値の節やグループは前の段と共有するので、1 段の大きさは変更量 × log(値の数) 程度
+		//戻す・やり直す時は、その段で変わった値と(変わっていれば)グループの配置だけを返す
+		class EditorHistory
+		{
+		public:
+			static constexpr size_t MaxSteps = 10000;
+
+			//戻す・やり直した結果として反映するもの
+			struct Change
+			{
+				ParameterData values;
+				bool layoutChanged = false;
+				std::vector<std::vector<String>> colorGroups;
+				std::vector<Vec2> groupPositions;
+			};
+
+			EditorHistory()
+			{
+				steps.emplace_back();
+			}
+
+			//現在の状態を履歴の起点にする(それまでの履歴は捨てる)
+			void reset(const EditorLayout& layout)
+			{
+				slotIndices = {};
+				slotNames = {};
+				steps.clear();
+				steps.emplace_back();
+				cursor = 0;
+
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					for (const auto& keyVal : layout.values.get<Type>())
+					{
+						add<Type>(keyVal.first, keyVal.second);
+					}
+				});
+				setLayout(steps.front().state, layout.colorGroups, layout.groupPositions);
+			}
+
+			//新しい名前を現在の状態に加える(段にはしない)
+			template <class Type>
+			void add(const String& name, const typename ParameterTraits<Type>::DataType& value)
+			{
+				constexpr size_t TypeIndex = ParameterTraits<Type>::Index;
+				if (slotIndices[TypeIndex].find(name) != slotIndices[TypeIndex].end())
+				{
+					return;
+				}
+
+				auto& values = std::get<TypeIndex>(steps[cursor].state.values);
+				slotIndices[TypeIndex].emplace(name, static_cast<uint32>(values.size()));
+				slotNames[TypeIndex].push_back(name);
+				values.push_back(value);
+			}
+
+			//ひとまとまりの操作を 1 段として積む(やり直せる段は捨てる)
+			//changed は操作で変わった可能性のある値、layoutChanged ならグループの配置も記録する
+			//実際には何も変わっていなければ積まずに false を返す
+			bool commit(const ParameterData& changed, bool layoutChanged, const std::vector<std::vector<String>>& colorGroups, const std::vector<Vec2>& groupPositions)
+			{
+				Step step;
+				step.state = steps[cursor].state;
+
+				bool valuesChanged = false;
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					using DataType = typename ParameterTraits<Type>::DataType;
+					constexpr size_t TypeIndex = ParameterTraits<Type>::Index;
+
+					auto& values = std::get<TypeIndex>(step.state.values);
+					std::vector<std::pair<uint32, DataType>> changes;
+					for (const auto& keyVal : changed.get<Type>())
+					{
+						const auto it = slotIndices[TypeIndex].find(keyVal.first);
+						if (it == slotIndices[TypeIndex].end() || values[it->second] == keyVal.second)
+						{
+							continue;
+						}
+
+						changes.emplace_back(it->second, keyVal.second);
+						step.changedSlots[TypeIndex].push_back(it->second);
+					}
+
+					values.assign(changes);
+					valuesChanged = valuesChanged || !changes.empty();
+				});
+
+				if (layoutChanged)
+				{
+					step.layoutChanged = setLayout(step.state, colorGroups, groupPositions);
+				}
+
+				if (!valuesChanged && !step.layoutChanged)
+				{
+					return false;
+				}
+
+				steps.erase(steps.begin() + cursor + 1, steps.end());
+				steps.push_back(std::move(step));
+				if (MaxSteps < steps.size())
+				{
+					steps.pop_front();
+				}
+				cursor = steps.size() - 1;
+				return true;
+			}
+
+			Optional<Change> undo()
+			{
+				if (cursor == 0)
+				{
+					return none;
+				}
+
+				const Step& step = steps[cursor];
+				State& previous = steps[cursor - 1].state;
+				extend(previous, step.state);
+				--cursor;
+				return makeChange(step, previous);
+			}
+
+			Optional<Change> redo()
+			{
+				if (steps.size() <= cursor + 1)
+				{
+					return none;
+				}
+
+				Step& next = steps[cursor + 1];
+				extend(next.state, steps[cursor].state);
+				++cursor;
+				return makeChange(next, next.state);
+			}
+
+		private:
+			using GroupArray = std::vector<std::shared_ptr<const std::vector<String>>>;
+
+			struct State
+			{
+				std::tuple<
+					PersistentArray<ColorF>,
+					PersistentArray<double>,
+					PersistentArray<int32>,
+					PersistentArray<bool>,
+					PersistentArray<Vec2>,
+					PersistentArray<ValueRange>,
+					PersistentArray<ColorAnimation>> values;
+				std::shared_ptr<const GroupArray> colorGroups = std::make_shared<const GroupArray>();
+				std::shared_ptr<const std::vector<Vec2>> groupPositions = std::make_shared<const std::vector<Vec2>>();
+			};
+
+			struct Step
+			{
+				State state;
+				//前の段から変わった値(型ごとの添字)
+				std::array<std::vector<uint32>, ParameterTypeCount> changedSlots;
+				bool layoutChanged = false;
+			};
+
+			//同じ内容のグループは前の状態と共有する(並べ替え・結合などで変わったグループだけ新しくなる)
+			//配置が前の状態と同じなら false を返す
+			static bool setLayout(State& state, const std::vector<std::vector<String>>& colorGroups, const std::vector<Vec2>& groupPositions)
+			{
+				std::unordered_map<String, std::shared_ptr<const std::vector<String>>> previousGroups;
+				for (const auto& group : *state.colorGroups)
+				{
+					if (!group->empty())
+					{
+						previousGroups.emplace(group->front(), group);
+					}
+				}
+
+				bool changed = colorGroups.size() != state.colorGroups->size();
+				auto nextGroups = std::make_shared<GroupArray>();
+				nextGroups->reserve(colorGroups.size());
+				for (size_t groupIndex = 0; groupIndex < colorGroups.size(); ++groupIndex)
+				{
+					const auto& group = colorGroups[groupIndex];
+					const auto it = group.empty() ? previousGroups.end() : previousGroups.find(group.front());
+					if (it != previousGroups.end() && *it->second == group)
+					{
+						nextGroups->push_back(it->second);
+					}
+					else
+					{
+						nextGroups->push_back(std::make_shared<const std::vector<String>>(group));
+					}
+					changed = changed || nextGroups->back() != (*state.colorGroups)[groupIndex];
+				}
+
+				if (groupPositions != *state.groupPositions)
+				{
+					state.groupPositions = std::make_shared<const std::vector<Vec2>>(groupPositions);
+					changed = true;
+				}
+
+				state.colorGroups = std::move(nextGroups);
+				return changed;
+			}
+
+			//後から追加された名前の値を source から写す(その名前はどの段でも同じ値として扱う)
+			static void extend(State& target, const State& source)
+			{
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					constexpr size_t TypeIndex = ParameterTraits<Type>::Index;
+
+					auto& targetValues = std::get<TypeIndex>(target.values);
+					const auto& sourceValues = std::get<TypeIndex>(source.values);
+					while (targetValues.size() < sourceValues.size())
+					{
+						targetValues.push_back(sourceValues[targetValues.size()]);
+					}
+				});
+			}
+
+			Change makeChange(const Step& step, const State& state)const
+			{
+				Change change;
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					constexpr size_t TypeIndex = ParameterTraits<Type>::Index;
+
+					const auto& values = std::get<TypeIndex>(state.values);
+					for (const uint32 slot : step.changedSlots[TypeIndex])
+					{
+						change.values.get<Type>()[slotNames[TypeIndex][slot]] = values[slot];
+					}
+				});
+
+				if (step.layoutChanged)
+				{
+					change.layoutChanged = true;
+					for (const auto& group : *state.colorGroups)
+					{
+						change.colorGroups.push_back(*group);
+					}
+					change.groupPositions = *state.groupPositions;
+				}
+				return change;
+			}
+
+			//名前と値の添字の対応(全段で共通、追加するだけ)
+			std::array<std::unordered_map<String, uint32>, ParameterTypeCount> slotIndices;
+			std::array<std::vector<String>, ParameterTypeCount> slotNames;
+
+			std::deque<Step> steps;
+			size_t cursor = 0;
+		};
+
+		//ワーカースレッドの起床管理
+		//更新要求(notify)か終了要求(terminate)が来るまでスレッドを眠らせ、起床間隔は tickInterval 以上空ける
+		class WorkerSignal
+		{
+		public:
+			void notify()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					updateRequest = true;
+				}
+				condition.notify_one();
+			}
+
+			void terminate()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					terminationRequest = true;
+				}
+				condition.notify_all();
+			}
+
+			//次の更新要求まで待つ(終了要求が来たら false を返す)
+			bool wait()
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				condition.wait_until(lock, nextTick, [this] { return terminationRequest.load(); });
+				condition.wait(lock, [this] { return updateRequest.load() || terminationRequest.load(); });
+
+				updateRequest = false;
+				nextTick = std::chrono::steady_clock::now() + tickInterval;
+
+				return !terminationRequest;
+			}
+
+			//ワーカーが 1 秒間に回る最大回数(0 以下で制限なし)
+			void setTickRate(double tickRate)
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				tickInterval = tickRate <= 0.0
+					? std::chrono::steady_clock::duration::zero()
+					: std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / tickRate));
+			}
+
+		private:
+			std::mutex mtx;
+			std::condition_variable condition;
+			std::atomic<bool> updateRequest{ false };
+			std::atomic<bool> terminationRequest{ false };
+
+			std::chrono::steady_clock::duration tickInterval = std::chrono::milliseconds(8);
+			std::chrono::steady_clock::time_point nextTick;
+		};
+
+		//journal.dat に追記する ServerState の変更 1 件分
+		struct SaveRecord
+		{
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				//クライアントは先頭の editedValues だけを読む
+				archive(editedValues, receivedValues, hasColorGroups, colorGroups, hasGroupPositions, groupPositions);
+			}
+
+			bool empty()const
+			{
+				return receivedValues.empty() && editedValues.empty() && !hasColorGroups && !hasGroupPositions;
+			}
+
+			//後の変更を重ねて 1 件にまとめる
+			void merge(SaveRecord&& other)
+			{
+				receivedValues.merge(other.receivedValues);
+				editedValues.merge(other.editedValues);
+
+				if (other.hasColorGroups)
+				{
+					hasColorGroups = true;
+					colorGroups = std::move(other.colorGroups);
+				}
+
+				if (other.hasGroupPositions)
+				{
+					hasGroupPositions = true;
+					groupPositions = std::move(other.groupPositions);
+				}
+			}
+
+			ParameterData receivedValues;
+			ParameterData editedValues;
+
+			bool hasColorGroups = false;
+			std::vector<std::vector<String>> colorGroups;
+
+			bool hasGroupPositions = false;
+			std::vector<Vec2> groupPositions;
+		};
+
+		//save.dat の中身(ServerState と同じ形式で読み書きできる、描画に依存しない部分だけのコピー)
+		struct SaveSnapshot
+		{
+			//クライアントは先頭の editor.values だけを読む
+			template <class Archive>
+			void SIV3D_SERIALIZE(Archive& archive)
+			{
+				archive(editor.values, receivedBuffer, editor.colorGroups, editor.groupPositions);
+			}
+
+			void apply(const SaveRecord& record)
+			{
+				receivedBuffer.merge(record.receivedValues);
+				editor.values.merge(record.editedValues);
+
+				if (record.hasColorGroups)
+				{
+					editor.colorGroups = record.colorGroups;
+				}
+
+				if (record.hasGroupPositions)
+				{
+					editor.groupPositions = record.groupPositions;
+				}
+			}
+
+			//スナップショット全体を 1 件の変更として表す
+			SaveRecord toRecord()const
+			{
+				SaveRecord record;
+				record.receivedValues = receivedBuffer;
+				record.editedValues = editor.values;
+				record.hasColorGroups = true;
+				record.colorGroups = editor.colorGroups;
+				record.hasGroupPositions = true;
+				record.groupPositions = editor.groupPositions;
+				return record;
+			}
+
+			ParameterData receivedBuffer;
+			EditorLayout editor;
+		};
+
+		//save.dat (スナップショット) と journal.dat (追記専用の変更履歴) による保存
+		//変更は 1 件ずつ journal.dat に追記し、journal.dat が大きくなったらスナップショットに畳み込む
+		//journal.dat の形式: [ペイロード長 (uint32)][SaveRecord] の繰り返し
+		class SaveJournal
+		{
+		public:
+			static constexpr int64 CompactionThreshold = 1 << 20;
+
+			//スナップショットに変更履歴を適用して復元する
+			//書きかけで途切れた最後の 1 件は捨てる
+			static void Load(const FilePath& directoryPath, SaveSnapshot& state)
+			{
+				const FilePath saveFilePath = directoryPath + U"save.dat";
+				if (FileSystem::Exists(saveFilePath) && !FileSystem::IsEmpty(saveFilePath))
+				{
+					Deserializer<BinaryReader> deserializer(saveFilePath);
+					deserializer(state);
+				}
+
+				ReadJournal(directoryPath + U"journal.dat", [&](Deserializer<ByteArray>& deserializer)
+				{
+					SaveRecord record;
+					deserializer(record);
+					state.apply(record);
+				});
+			}
+
+			//クライアント用: エディタで編集した値だけを読む
+			//save.dat も journal.dat の各記録も値を先頭に置いているので、その後ろ(グループの配置など)は読まない
+			static void LoadValues(const FilePath& directoryPath, ParameterData& values)
+			{
+				const FilePath saveFilePath = directoryPath + U"save.dat";
+				try
+				{
+					if (FileSystem::Exists(saveFilePath) && !FileSystem::IsEmpty(saveFilePath))
+					{
+						Deserializer<BinaryReader> deserializer(saveFilePath);
+						deserializer(values);
+					}
+				}
+				catch (std::exception& e)
+				{
+					Logger << Unicode::Widen(e.what());
+				}
+
+				ReadJournal(directoryPath + U"journal.dat", [&](Deserializer<ByteArray>& deserializer)
+				{
+					ParameterData editedValues;
+					deserializer(editedValues);
+					values.merge(editedValues);
+				});
+			}
+
+			//Load の後に呼ぶ(既存の変更履歴の後ろに追記する)
+			//途切れた記録の後ろに追記すると次に読めなくなるので、読める所までに切り詰めてから開く
+			void open(const FilePath& newDirectoryPath)
+			{
+				directoryPath = newDirectoryPath;
+
+				const FilePath journalFilePath = directoryPath + U"journal.dat";
+				const FilePath temporaryFilePath = directoryPath + U"journal.dat.tmp";
+
+				const int64 validSize = ReadJournal(journalFilePath, [](Deserializer<ByteArray>& deserializer)
+				{
+					SaveRecord record;
+					deserializer(record);
+				});
+
+				if (FileSystem::Exists(journalFilePath) && validSize < FileSystem::Size(journalFilePath))
+				{
+					Array<Byte> validBytes(static_cast<size_t>(validSize));
+					{
+						BinaryReader reader(journalFilePath);
+						reader.read(validBytes.data(), validSize);
+					}
+
+					//書き換えの途中で終了しても元の journal.dat が残るように、一時ファイルに書いてから置き換える
+					{
+						BinaryWriter temporaryWriter(temporaryFilePath);
+						temporaryWriter.write(validBytes.data(), validBytes.size());
+					}
+					ReplaceFile(temporaryFilePath, journalFilePath);
+				}
+
+				writer = BinaryWriter(journalFilePath, OpenMode::Append);
+			}
+
+			bool isOpen()const
+			{
+				return writer.isOpened();
+			}
+
+			void append(const SaveRecord& record)
+			{
+				Serializer<MemoryWriter> serializer;
+				serializer(record);
+				const auto& recordWriter = serializer.getWriter();
+
+				const uint32 payloadSize = static_cast<uint32>(recordWriter.size());
+				writer.write(payloadSize);
+				writer.write(recordWriter.data(), payloadSize);
+				writer.flush();
+			}
+
+			bool needsCompaction()const
+			{
+				return CompactionThreshold <= writer.size();
+			}
+
+			//現在の状態をスナップショットとして書き出し、変更履歴を空にする
+			//スナップショットは一時ファイルに書いてから置き換える
+			void compact(const SaveSnapshot& state)
+			{
+				const FilePath saveFilePath = directoryPath + U"save.dat";
+				const FilePath temporaryFilePath = directoryPath + U"save.dat.tmp";
+				{
+					Serializer<BinaryWriter> serializer(temporaryFilePath);
+					serializer(state);
+				}
+
+				ReplaceFile(temporaryFilePath, saveFilePath);
+
+				writer = BinaryWriter(directoryPath + U"journal.dat");
+			}
+
+		private:
+			//to を from で 1 回の操作で置き換える(消してから名前を変えると、その間に読んだクライアントが to を見失う)
+			//Windows では MoveFileEx(MOVEFILE_REPLACE_EXISTING), それ以外では rename になる
+			//一時ファイルは書き終えてから置き換えるので、途中で終了して残った一時ファイルは読まずに次の書き出しで上書きする
+			static void ReplaceFile(const FilePath& from, const FilePath& to)
+			{
+				std::error_code error;
+				std::filesystem::rename(std::filesystem::path(from.toWstr()), std::filesystem::path(to.toWstr()), error);
+				if (error)
+				{
+					Logger << Unicode::Widen(error.message());
+				}
+			}
+
+			//journal.dat の記録を先頭から順に読み、1 件ずつ f(deserializer) に渡す
+			//書きかけで途切れた記録か、f が読めなかった(例外を投げた)記録で止め、そこまでの大きさを返す
+			template <class Function>
+			static int64 ReadJournal(const FilePath& journalFilePath, Function f)
+			{
+				if (!FileSystem::Exists(journalFilePath))
+				{
+					return 0;
+				}
+
+				BinaryReader reader(journalFilePath);
+				int64 validSize = 0;
+				for (;;)
+				{
+					uint32 payloadSize = 0;
+					if (!reader.read(payloadSize) || reader.size() - reader.getPos() < payloadSize)
+					{
+						break;
+					}
+
+					Array<Byte> payload(payloadSize);
+					reader.read(payload.data(), payloadSize);
+
+					try
+					{
+						Deserializer<ByteArray> deserializer(payload.data(), payload.size());
+						f(deserializer);
+					}
+					catch (std::exception& e)
+					{
+						Logger << Unicode::Widen(e.what());
+						break;
+					}
+
+					validSize = reader.getPos();
+				}
+				return validSize;
+			}
+
+			FilePath directoryPath;
+			BinaryWriter writer;
+		};
+
+		//リリースビルド用に値を constexpr の配列として書き出したヘッダーを作る
+		//ゲーム側で PMT_BAKED_HEADER にこのヘッダーのパスを定義すると、ファイルも通信も使わずにこの値を返す
+		//各配列は名前の昇順に並べる(コンパイル時・実行時とも二分探索で引く)
+		class BakedHeader
+		{
+		public:
+			static bool Write(const ParameterData& values, const FilePath& headerPath)
+			{
+				TextWriter writer(headerPath);
+				if (!writer.isOpened())
+				{
+					return false;
+				}
+
+				writer.writeln(U"#pragma once");
+				writer.writeln(U"//SivParamEditor が書き出したパラメータの値(手で編集しないこと)");
+				writer.writeln(U"");
+				writer.writeln(U"namespace pmt");
+				writer.writeln(U"{");
+				writer.writeln(U"\tnamespace detailImpl");
+				writer.writeln(U"\t{");
+				writer.writeln(U"\t\tnamespace baked");
+				writer.writeln(U"\t\t{");
+
+				writeEntries<Color>(writer, values, U"Colors", U"::s3d::Color");
+				writeEntries<double>(writer, values, U"Floats", U"double");
+				writeEntries<int32>(writer, values, U"Ints", U"::s3d::int32");
+				writeEntries<bool>(writer, values, U"Bools", U"bool");
+				writeEntries<Vec2>(writer, values, U"Vec2s", U"::s3d::Vec2");
+				writeEntries<ValueRange>(writer, values, U"Ranges", U"::pmt::ValueRange");
+				writeAnimations(writer, values);
+
+				writer.writeln(U"\t\t}");
+				writer.writeln(U"\t}");
+				writer.writeln(U"}");
+				return true;
+			}
+
+			//保存先のディレクトリ(末尾に / を付ける)の save.dat と journal.dat から書き出す
+			static bool WriteFromSave(const FilePath& directoryPath, const FilePath& headerPath)
+			{
+				SaveSnapshot state;
+				SaveJournal::Load(directoryPath, state);
+				return Write(state.editor.values, headerPath);
+			}
+
+		private:
+			template <class Type>
+			static void writeEntries(TextWriter& writer, const ParameterData& values, const String& arrayName, const String& typeName)
+			{
+				Array<std::pair<String, Type>> entries;
+				for (const auto& keyVal : values.get<Type>())
+				{
+					entries.emplace_back(keyVal.first, Type(keyVal.second));
+				}
+				std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+				writer.writeln(U"\t\t\tinline constexpr std::array<BakedEntry<{}>, {}> {} ="_fmt(typeName, entries.size(), arrayName));
+				writer.writeln(U"\t\t\t{ {");
+				for (const auto& entry : entries)
+				{
+					writer.writeln(U"\t\t\t\t{{ {}, {} }},"_fmt(ToLiteral(entry.first), ToLiteral(entry.second)));
+				}
+				writer.writeln(U"\t\t\t} };");
+				writer.writeln(U"");
+			}
+
+			static void writeAnimations(TextWriter& writer, const ParameterData& values)
+			{
+				Array<std::pair<String, ColorAnimation>> entries(values.animations.begin(), values.animations.end());
+				std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+				size_t keyCount = 0;
+				for (const auto& entry : entries)
+				{
+					keyCount += entry.second.keys.size();
+				}
+
+				writer.writeln(U"\t\t\tinline constexpr std::array<BakedKeyframe, {}> AnimationKeys ="_fmt(keyCount));
+				writer.writeln(U"\t\t\t{ {");
+				for (const auto& entry : entries)
+				{
+					for (const auto& key : entry.second.keys)
+					{
+						writer.writeln(U"\t\t\t\t{{ {}, {}, {}, {}, {}, ::pmt::AnimationEasing({}) }},"_fmt(
+							ToLiteral(key.time), ToLiteral(key.color.r), ToLiteral(key.color.g), ToLiteral(key.color.b), ToLiteral(key.color.a), static_cast<uint32>(key.easing)));
+					}
+				}
+				writer.writeln(U"\t\t\t} };");
+				writer.writeln(U"");
+
+				writer.writeln(U"\t\t\tinline constexpr std::array<BakedEntry<BakedAnimation>, {}> Animations ="_fmt(entries.size()));
+				writer.writeln(U"\t\t\t{ {");
+				size_t firstKey = 0;
+				for (const auto& entry : entries)
+				{
+					writer.writeln(U"\t\t\t\t{{ {}, {{ {}, {}, {}, {} }} }},"_fmt(
+						ToLiteral(entry.first), firstKey, entry.second.keys.size(), ToLiteral(entry.second.duration), ToLiteral(entry.second.loop)));
+					firstKey += entry.second.keys.size();
+				}
+				writer.writeln(U"\t\t\t} };");
+				writer.writeln(U"");
+			}
+
+			static String ToLiteral(const String& name)
+			{
+				String literal = U"U\"";
+				for (const char32_t ch : name)
+				{
+					if (ch == U'\\' || ch == U'"')
+					{
+						literal.push_back(U'\\');
+						literal.push_back(ch);
+					}
+					else if (ch < 0x20 || ch == 0x7F)
+					{
+						literal.append(U"\\U" + ToHex(static_cast<uint32>(ch)).lpadded(8, U'0'));
+					}
+					else
+					{
+						literal.push_back(ch);
+					}
+				}
+				literal.push_back(U'"');
+				return literal;
+			}
+
+			//読み込み直した時に同じ値になるように 17 桁で書く
+			static String ToLiteral(double value)
+			{
+				if (std::isnan(value))
+				{
+					return U"::std::numeric_limits<double>::quiet_NaN()";
+				}
+
+				if (std::isinf(value))
+				{
+					return value < 0.0 ? U"-::std::numeric_limits<double>::infinity()" : U"::std::numeric_limits<double>::infinity()";
+				}
+
+				std::ostringstream stream;
+				stream.imbue(std::locale::classic());
+				stream.precision(std::numeric_limits<double>::max_digits10);
+				stream << value;
+
+				String literal = Unicode::Widen(stream.str());
+				if (!literal.includes(U'.') && !literal.includes(U'e'))
+				{
+					literal.append(U".0");
+				}
+				return literal;
+			}
+
+			static String ToLiteral(int32 value)
+			{
+				return U"::s3d::int32({})"_fmt(static_cast<int64>(value));
+			}
+
+			static String ToLiteral(bool value)
+			{
+				return value ? U"true" : U"false";
+			}
+
+			static String ToLiteral(const Color& value)
+			{
+				return U"::s3d::Color({}, {}, {}, {})"_fmt(static_cast<uint32>(value.r), static_cast<uint32>(value.g), static_cast<uint32>(value.b), static_cast<uint32>(value.a));
+			}
+
+			static String ToLiteral(const Vec2& value)
+			{
+				return U"::s3d::Vec2({}, {})"_fmt(ToLiteral(value.x), ToLiteral(value.y));
+			}
+
+			static String ToLiteral(const ValueRange& value)
+			{
+				return U"::pmt::ValueRange{{ {}, {} }}"_fmt(ToLiteral(value.min), ToLiteral(value.max));
+			}
+		};
+
+		//save.dat / journal.dat への書き込みを担当するスレッド
+		//同期処理のスレッドは変更を積むだけで、ディスクへの書き込みを待たない
+		//保存用の状態はこのスレッドが自前で持つので、畳み込みの際にメインスレッドの状態を止める必要もない
+		class SaveThread
+		{
+		public:
+			SaveThread(const FilePath& directoryPath, SaveSnapshot&& initialSnapshot) :
+				snapshot(std::move(initialSnapshot))
+			{
+				journal.open(directoryPath);
+				signal.setTickRate(20.0);
+				thread = std::thread([this] { run(); });
+			}
+
+			SaveThread(const SaveThread&) = delete;
+
+			~SaveThread()
+			{
+				signal.terminate();
+				thread.join();
+			}
+
+			void push(std::vector<SaveRecord>&& records)
+			{
+				if (records.empty())
+				{
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					for (auto& record : records)
+					{
+						pendingRecords.push_back(std::move(record));
+					}
+				}
+				signal.notify();
+			}
+
+		private:
+			void run()
+			{
+				while (signal.wait())
+				{
+					flush();
+				}
+
+				//終了前に残りを書き出す
+				flush();
+			}
+
+			void flush()
+			{
+				std::vector<SaveRecord> records;
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					records.swap(pendingRecords);
+				}
+
+				//溜まった変更を 1 件にまとめ、何も変わっていなければ書かない
+				SaveRecord merged;
+				for (auto& record : records)
+				{
+					merged.merge(std::move(record));
+				}
+
+				if (merged.empty())
+				{
+					return;
+				}
+
+				snapshot.apply(merged);
+				journal.append(merged);
+
+				if (journal.needsCompaction())
+				{
+					journal.compact(snapshot);
+				}
+			}
+
+			SaveJournal journal;
+			SaveSnapshot snapshot;
+
+			std::mutex mtx;
+			std::vector<SaveRecord> pendingRecords;
+
+			WorkerSignal signal;
+			std::thread thread;
+		};
+
+		//エディタ側の通信(ハンドシェイク・差分の送受信・保存用スレッドへの受け渡し)
+		//描画・入力は使わないので、エディタの UI を使わずに動かせる(Benchmark.cpp のように Siv3D のアプリケーションの中で)
+		//複数のクライアントを 1 つのワーカースレッドで扱い、エディタでの変更は接続中の全クライアントに送る
+		//同じ ParameterEditor ディレクトリを使うクライアントが複数あってもよい(通信用のファイルはクライアントごとのディレクトリに分かれる)
+		class EditorServer
+		{
+		public:
+			EditorServer()
+			{
+				worker = std::thread([this] { run(); });
+			}
+
+			EditorServer(const EditorServer&) = delete;
+
+			~EditorServer()
+			{
+				signal.terminate();
+				worker.join();
+				saveThreads.clear();
+			}
+
+			void notify()
+			{
+				signal.notify();
+			}
+
+			void setTickRate(double tickRate)
+			{
+				signal.setTickRate(tickRate);
+			}
+
+			//前回から受信した値を取り出す
+			//接続中のクライアントが無い状態で新しいクライアントが来たら、そのセーブデータが loadedSnapshot に入る
+			void take(Optional<SaveSnapshot>& loadedSnapshot, ParameterData& received)
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				loadedSnapshot = std::move(this->loadedSnapshot);
+				this->loadedSnapshot = none;
+				received = std::move(receivedValues);
+				receivedValues = ParameterData();
+			}
+
+			//ゲームから返ってきた計測結果を取り出す
+			Array<LatencyTrace> takeLatencies()
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				Array<LatencyTrace> result;
+				result.swap(receivedLatencies);
+				return result;
+			}
+
+			//接続中の全クライアントへ送る(送る前に同じ名前の変更は最新の値だけになる)
+			//editedAt は values の中で最も古い変更の時刻(TraceClock, 0 なら計測しない)
+			void send(const ParameterData& values, int64 editedAt = 0)
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				sendBuffer.merge(values);
+				sendEditedAt = EarlierTrace(sendEditedAt, editedAt);
+			}
+
+			//接続中のクライアントのディレクトリそれぞれの journal.dat に追記する
+			void save(SaveRecord&& record)
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				pendingRecords.push_back(std::move(record));
+			}
+
+		private:
+			//クライアント 1 つ分の状態
+			struct ClientSession
+			{
+				enum Phase { Error, Handshake, WaitingClient, Running };
+				//Error         バージョン番号の不一致など(切断されるまでそのまま)
+				//Handshake     ディレクトリ情報の受信待ち
+				//WaitingClient クライアントが receive.dat のバージョン番号を読むのを待つ
+				//Running       通常状態
+
+				bool isActive()const
+				{
+					return phase == WaitingClient || phase == Running;
+				}
+
+				TCPSessionID id = 0;
+				Phase phase = Handshake;
+				bool failureReported = false;
+
+				String directoryPath;
+				//ClientDirectoryPath で決まる、このクライアントの通信用のディレクトリ
+				String clientDirectoryPath;
+				MessageChannel channel;
+
+				ParameterEncoder encoder;
+				ParameterDecoder decoder;
+
+				//このクライアントへまだ送っていない変更
+				ParameterData sendBuffer;
+				int64 sendEditedAt = 0;
+				Optional<ParameterMessage> pendingMessage;
+			};
+
+			static int64 EarlierTrace(int64 a, int64 b)
+			{
+				if (a == 0 || b == 0)
+				{
+					return a == 0 ? b : a;
+				}
+				return Min(a, b);
+			}
+
+			void run()
+			{
+				server.startAcceptMulti(PortNumber);
+
+				while (signal.wait())
+				{
+					update();
+				}
+
+				//終了要求より前に積まれた変更も送り、保存用スレッドに渡してから終える
+				update();
+				drainSends();
+			}
+
+			void update()
+			{
+				//新しい接続を登録し、切れたものを捨てる
+				for (const auto id : server.getSessionIDs())
+				{
+					const bool known = std::any_of(sessions.begin(), sessions.end(), [&](const auto& session) { return session->id == id; });
+					if (!known)
+					{
+						auto session = std::make_unique<ClientSession>();
+						session->id = id;
+						sessions.push_back(std::move(session));
+					}
+				}
+
+				//切れたクライアントの通信用のディレクトリは、リングバッファのマップを閉じてから消す
+				for (auto& session : sessions)
+				{
+					if (!server.hasSession(session->id) && !session->clientDirectoryPath.isEmpty())
+					{
+						session->channel = MessageChannel();
+						FileSystem::Remove(session->clientDirectoryPath);
+					}
+				}
+				sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [&](const auto& session) { return !server.hasSession(session->id); }), sessions.end());
+
+				//エディタでの変更と保存する記録を受け取る
+				ParameterData outbound;
+				int64 outboundEditedAt = 0;
+				std::vector<SaveRecord> records;
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					outbound = std::move(sendBuffer);
+					sendBuffer = ParameterData();
+					outboundEditedAt = sendEditedAt;
+					sendEditedAt = 0;
+					records.swap(pendingRecords);
+				}
+
+				ParameterData receivedBatch;
+				Array<LatencyTrace> latencies;
+				for (auto& session : sessions)
+				{
+					switch (session->phase)
+					{
+					case ClientSession::Error:
+					{
+						if (!session->failureReported)
+						{
+							ReportStatus(U"初期化に失敗");
+							session->failureReported = true;
+						}
+						break;
+					}
+					case ClientSession::Handshake:
+					{
+						//接続中のクライアントが他に無ければ、このクライアントのセーブデータでエディタを復元する
+						//それより前に積まれていた記録は古い状態に対するものなので捨てる
+						if (handshake(*session))
+						{
+							records.clear();
+						}
+						break;
+					}
+					case ClientSession::WaitingClient:
+					{
+						const auto sendFilePath = session->clientDirectoryPath + U"receive.dat";
+
+						if (FileSystem::IsEmpty(sendFilePath))
+						{
+							//以降の通信もこの接続を使い続ける
+							session->phase = ClientSession::Running;
+						}
+
+						break;
+					}
+					case ClientSession::Running:
+					{
+						receive(*session, receivedBatch, latencies);
+						break;
+					}
+					default: break;
+					}
+
+					if (session->isActive())
+					{
+						session->sendBuffer.merge(outbound);
+						session->sendEditedAt = EarlierTrace(session->sendEditedAt, outboundEditedAt);
+					}
+
+					if (session->phase == ClientSession::Running)
+					{
+						send(*session);
+					}
+				}
+
+				//受信した値とエディタでの変更は保存用のスレッドに渡す
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					receivedValues.merge(receivedBatch);
+					receivedLatencies.insert(receivedLatencies.end(), latencies.begin(), latencies.end());
+				}
+
+				if (!receivedBatch.empty())
+				{
+					SaveRecord record;
+					record.receivedValues = std::move(receivedBatch);
+					records.push_back(std::move(record));
+				}
+
+				for (const auto& record : records)
+				{
+					editorSnapshot.apply(record);
+				}
+
+				for (auto& pathThread : saveThreads)
+				{
+					pathThread.second->push(std::vector<SaveRecord>(records));
+				}
+			}
+
+			//送りきれていないメッセージを、クライアントが受け取るのを少しだけ待って送る
+			void drainSends()
+			{
+				const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+				for (;;)
+				{
+					bool pending = false;
+					for (auto& session : sessions)
+					{
+						if (session->phase != ClientSession::Running || !server.hasSession(session->id))
+						{
+							continue;
+						}
+
+						send(*session);
+						if (session->pendingMessage || !session->channel.flush())
+						{
+							pending = true;
+						}
+					}
+
+					if (!pending || deadline <= std::chrono::steady_clock::now())
+					{
+						return;
+					}
+
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+
+			//ディレクトリ情報を受け取ってバージョン番号を確認する
+			//このクライアントのセーブデータでエディタを復元した場合は true
+			bool handshake(ClientSession& session)
+			{
+				//Window::SetTitle(U"TCPServer: 接続完了！");
+
+				Array<Byte> byteArray(HandshakeSize);
+				if (!server.read(byteArray.data(), HandshakeSize, session.id))
+				{
+					return false;
+				}
+
+				Deserializer<ByteArray> filePathDeserializer(byteArray);
+
+				std::array<char32_t, 256> filePath{};
+				uint64 clientID = 0;
+				filePathDeserializer(filePath);
+				filePathDeserializer(clientID);
+
+				session.directoryPath = String(filePath.data());
+				session.clientDirectoryPath = ClientDirectoryPath(session.directoryPath, clientID);
+				session.phase = ClientSession::WaitingClient;
+				//クライアントの send.dat を受け取り、receive.dat に送る
+				session.channel.setFiles(session.clientDirectoryPath, session.clientDirectoryPath + U"receive.dat", session.clientDirectoryPath + U"send.dat");
+
+				const auto sendFilePath = session.clientDirectoryPath + U"receive.dat";
+				{
+					Serializer<BinaryWriter> serializer(sendFilePath);
+					serializer(EditorVersion);
+				}
+
+				//クライアントはサーバーと通信を行うよりも前に send.dat にバージョンを記録しているのでここで読めるはず
+				const auto receiveFilePath = session.clientDirectoryPath + U"send.dat";
+				if (!FileSystem::IsEmpty(receiveFilePath))
+				{
+					{
+						Deserializer<BinaryReader> deserializer(receiveFilePath);
+
+						unsigned version;
+						deserializer(version);
+
+						if (version != EditorVersion)
+						{
+							session.phase = ClientSession::Error;
+							return false;
+						}
+					}
+
+					BinaryWriter writer(receiveFilePath);
+				}
+				else
+				{
+					session.phase = ClientSession::Error;
+					return false;
+				}
+
+				//クライアントがリングバッファを用意していればそちらを使う
+				const auto sendRingPath = session.clientDirectoryPath + U"receive.ring";
+				const auto receiveRingPath = session.clientDirectoryPath + U"send.ring";
+				if (FileSystem::Exists(sendRingPath) && FileSystem::Exists(receiveRingPath))
+				{
+					session.channel.openRings(sendRingPath, receiveRingPath);
+				}
+
+				//セーブデータを復元し、以降の変更はその後ろに追記していく
+				SaveSnapshot snapshot;
+				SaveJournal::Load(session.directoryPath, snapshot);
+
+				const bool primary = std::none_of(sessions.begin(), sessions.end(), [&](const auto& other) { return other.get() != &session && other->isActive(); });
+				if (primary)
+				{
+					saveThreads.clear();
+					saveThreads[session.directoryPath] = std::make_unique<SaveThread>(session.directoryPath, SaveSnapshot(snapshot));
+					editorSnapshot = snapshot;
+					{
+						std::lock_guard<std::mutex> lock(mtx);
+						loadedSnapshot = std::move(snapshot);
+						receivedValues = ParameterData();
+						pendingRecords.clear();
+					}
+					return true;
+				}
+
+				//既に編集中の状態をこのクライアントとそのセーブデータにも反映する
+				if (saveThreads.find(session.directoryPath) == saveThreads.end())
+				{
+					auto saveThread = std::make_unique<SaveThread>(session.directoryPath, std::move(snapshot));
+					std::vector<SaveRecord> records;
+					records.push_back(editorSnapshot.toRecord());
+					saveThread->push(std::move(records));
+					saveThreads[session.directoryPath] = std::move(saveThread);
+				}
+				session.sendBuffer.merge(editorSnapshot.editor.values);
+
+				return false;
+			}
+
+			void receive(ClientSession& session, ParameterData& receivedBatch, Array<LatencyTrace>& latencies)
+			{
+				session.channel.receive(SessionSocket{ server, session.id }, [&](const ParameterMessage& message)
+				{
+					session.decoder.decode(message, receivedBatch);
+					latencies.insert(latencies.end(), message.latencies.begin(), message.latencies.end());
+				});
+			}
+
+			void send(ClientSession& session)
+			{
+				if (!session.pendingMessage && !session.sendBuffer.empty())
+				{
+					session.pendingMessage = session.encoder.encode(session.sendBuffer);
+					session.pendingMessage.value().editedAt = session.sendEditedAt;
+					session.sendBuffer = ParameterData();
+					session.sendEditedAt = 0;
+				}
+
+				session.channel.flush();
+				if (!session.pendingMessage)
+				{
+					return;
+				}
+
+				auto& message = session.pendingMessage.value();
+				if (message.editedAt != 0)
+				{
+					message.sentAt = TraceClock();
+				}
+
+				if (session.channel.send(SessionSocket{ server, session.id }, message))
+				{
+					session.pendingMessage = none;
+				}
+			}
+
+			TCPServer server;
+			std::vector<std::unique_ptr<ClientSession>> sessions;
+
+			WorkerSignal signal;
+
+			//エディタの状態を保存したもの(後から接続したクライアントに送る・保存する元になる)
+			SaveSnapshot editorSnapshot;
+			//ディレクトリごとの保存用スレッド(最後のクライアントが切れた後の変更も保存するため切断しても残す)
+			std::unordered_map<FilePath, std::unique_ptr<SaveThread>> saveThreads;
+
+			//ワーカーとメインスレッドの間の受け渡し(mtx で保護)
+			std::mutex mtx;
+			Optional<SaveSnapshot> loadedSnapshot;
+			ParameterData receivedValues;
+			std::vector<SaveRecord> pendingRecords;
+			ParameterData sendBuffer;
+			int64 sendEditedAt = 0;
+			Array<LatencyTrace> receivedLatencies;
+
+			std::thread worker;
+		};
+
+		class ParameterEditor
+		{
+		public:
+			static void Update()
+			{
+				auto& i = instance();
+				i.signal.notify();
+
+				//ワーカーが公開した変更をここでまとめて反映する
+				//値の取得は公開済みの複製から行うので、storages の更新はロック中に済ませればよい
+				std::unique_ptr<ReceivedBatch> batch(i.publishedBatch.exchange(nullptr));
+
+				//購読のハンドラはロックを外してから呼ぶ(ハンドラの中で pmt::Get などを呼べるように)
+				std::vector<std::pair<ChangeHandler, String>> notifications;
+				{
+					std::lock_guard<std::mutex> lock(i.registryMutex);
+					i.mainThreadId = std::this_thread::get_id();
+					bool traceChanged = false;
+					if (batch)
+					{
+						i.setValues(batch->values);
+						i.collectNotifications(batch->values, notifications);
+
+						//計測対象の値は、この後ゲームが初めて読んだ時点で計測を終える
+						//読まれる前に次の計測が届いたら新しい方だけを追跡する
+						if (!batch->traces.empty())
+						{
+							const int64 appliedAt = TraceClock();
+							for (auto& pending : batch->traces)
+							{
+								pending.trace.appliedAt = appliedAt;
+								i.readTrace = pending;
+							}
+							i.readTraceAge = 0;
+							traceChanged = true;
+						}
+					}
+
+					//数フレーム読まれなかった計測は諦める(その値を読まないゲームで追跡し続けないように)
+					if (i.readTrace && TraceExpiryFrames <= i.readTraceAge++)
+					{
+						i.readTrace = none;
+						traceChanged = true;
+					}
+
+					if (traceChanged)
+					{
+						i.resolveReadTrace();
+					}
+
+					if (batch || i.snapshotDirty)
+					{
+						i.publishSnapshot();
+					}
+				}
+
+				for (const auto& notification : notifications)
+				{
+					notification.first(notification.second);
+				}
+			}
+
+			static void SetTickRate(double tickRate)
+			{
+				auto& i = instance();
+				i.signal.setTickRate(tickRate);
+			}
+
+			//prefix 以下(区切り単位の前方一致)に登録されている名前を返す(部分木の大きさに比例する)
+			static Array<String> List(const String& prefix)
+			{
+				auto& i = instance();
+				std::lock_guard<std::mutex> lock(i.registryMutex);
+				return i.tree.list(prefix);
+			}
+
+			//prefix 以下の値がエディタから変更された時に handler(name) を呼ぶ
+			//handler は pmt::Update() の中で、変更を反映した後に呼ばれる
+			static uint32 Subscribe(const String& prefix, const ChangeHandler& handler)
+			{
+				auto& i = instance();
+				std::lock_guard<std::mutex> lock(i.registryMutex);
+				const uint32 id = ++i.lastSubscriptionID;
+				const uint32 node = i.tree.touch(prefix);
+				i.tree.addSubscription(node, id);
+				i.subscriptions.emplace(id, Subscription{ node, handler });
+				return id;
+			}
+
+			static void Unsubscribe(uint32 id)
+			{
+				auto& i = instance();
+				std::lock_guard<std::mutex> lock(i.registryMutex);
+				const auto it = i.subscriptions.find(id);
+				if (it == i.subscriptions.end())
+				{
+					return;
+				}
+
+				i.tree.removeSubscription(it->second.node, id);
+				i.subscriptions.erase(it);
+			}
+
+			//defaultValue は未登録の名前だった場合にだけ使う(none なら型ごとの既定値)
+			//登録済みの名前ならロックを取らずに複製から引く(どのスレッドからでも呼べる)
+			template <class Type>
+			static Param<Type> Register(const String& name, const Optional<Type>& defaultValue)
+			{
+				auto& i = instance();
+				{
+					const auto& indices = (*i.getSnapshot().indices)[ParameterTraits<Type>::Index];
+					const auto it = indices.find(name);
+					if (it != indices.end())
+					{
+						return Param<Type>(it->second);
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(i.registryMutex);
+				auto& storage = i.getStorage<Type>();
+				const auto it = storage.indices.find(name);
+				if (it != storage.indices.end())
+				{
+					return Param<Type>(it->second);
+				}
+
+				return Param<Type>(i.registerValue<Type>(name, defaultValue ? defaultValue.value() : ParameterTraits<Type>::Default()));
+			}
+
+			//値は次の Update() までフレーム内で一定
+			//どのスレッドからでも呼べる(エポックが変わらない限りスレッドごとの複製を読むだけでロックしない)
+			template <class Type>
+			static Type Get(const Param<Type>& param)
+			{
+				auto& i = instance();
+				if (i.tracing.load(std::memory_order_relaxed))
+				{
+					i.traceRead<Type>(param.index);
+				}
+
+				const auto& values = *std::get<ParameterTraits<Type>::Index>(i.getSnapshot().values);
+				if (param.index < values.size())
+				{
+					return values[param.index];
+				}
+
+				//次の Update() までに登録された値はまだ複製に入っていない
+				std::lock_guard<std::mutex> lock(i.registryMutex);
+				return i.getStorage<Type>().values[param.index];
+			}
+
+			//色をまとめて取得する(Output は Color か ColorF, 複製の確認は呼び出しごとに 1 回だけ)
+			template <class Output>
+			static void GetColors(const Param<Color>* params, size_t count, Output* results)
+			{
+				auto& i = instance();
+				if (i.tracing.load(std::memory_order_relaxed))
+				{
+					for (size_t n = 0; n < count; ++n)
+					{
+						i.traceRead<Color>(params[n].index);
+					}
+				}
+
+				const auto& values = *std::get<ParameterTraits<Color>::Index>(i.getSnapshot().values);
+				GatherColors(params, count, results, [&](const Param<Color>* blockParams, size_t blockCount, Color* colors)
+				{
+					for (size_t n = 0; n < blockCount; ++n)
+					{
+						const uint32 index = blockParams[n].index;
+						if (index < values.size())
+						{
+							colors[n] = values[index];
+						}
+						else
+						{
+							//次の Update() までに登録された値(Get を呼ぶと values の複製が差し替わりうるので直接読む)
+							std::lock_guard<std::mutex> lock(i.registryMutex);
+							colors[n] = i.getStorage<Color>().values[index];
+						}
+					}
+				});
+			}
+
+			//アニメーションする色をまとめて time 秒の時点で評価する(Update() と同じスレッドで 1 フレームに 1 回)
+			//並べ直しはアニメーションの値が変わって複製が作り直された時だけ行う(他の型の変更では作り直さない)
+			static void Animate(double time)
+			{
+				auto& i = instance();
+				const auto& source = std::get<ParameterTraits<ColorAnimation>::Index>(i.getSnapshot().values);
+				if (i.animationSource != source)
+				{
+					i.animations.build(*source);
+					i.animationSource = source;
+				}
+				i.animations.evaluate(time);
+			}
+
+			//Animate で求めた色を返す(どのスレッドからでも呼べる)
+			static Color GetAnimated(const Param<ColorAnimation>& param)
+			{
+				auto& i = instance();
+				if (i.tracing.load(std::memory_order_relaxed))
+				{
+					i.traceRead<ColorAnimation>(param.index);
+				}
+
+				const auto& colors = i.animations.current();
+				if (param.index < colors.size())
+				{
+					return colors[param.index];
+				}
+
+				//まだまとめて評価されていない
+				return AnimationEvaluator::Evaluate(Get(param), i.animations.getTime());
+			}
+
+		private:
+			//読まれないまま計測を諦めるまでの Update() の回数
+			static constexpr uint32 TraceExpiryFrames = 3;
+			static constexpr uint8 NoTracedType = static_cast<uint8>(ParameterTypeCount);
+
+			//計測中の変更と、その代表として追跡する値
+			struct PendingTrace
+			{
+				LatencyTrace trace;
+				ParameterType type = ParameterType::Color;
+				String name;
+			};
+
+			//ワーカーからメインスレッドへ受け渡す受信分
+			struct ReceivedBatch
+			{
+				ParameterData values;
+				Array<PendingTrace> traces;
+			};
+
+			//pmt::Subscribe で登録された購読(node は購読の起点にした木の節)
+			struct Subscription
+			{
+				uint32 node = ParameterTree::Root;
+				ChangeHandler handler;
+			};
+
+			using IndexTable = std::array<std::unordered_map<String, uint32>, ParameterTypeCount>;
+
+			template <class Type>
+			using SharedValues = std::shared_ptr<const std::vector<Type>>;
+
+			//どのスレッドからでも読める値の複製(Update() で変更があった時だけ作り直す)
+			//型ごとの配列は、その型に変更が無ければ前の複製と共有する
+			struct ValueSnapshot
+			{
+				uint64 epoch = 0;
+				std::tuple<
+					SharedValues<Color>,
+					SharedValues<double>,
+					SharedValues<int32>,
+					SharedValues<bool>,
+					SharedValues<Vec2>,
+					SharedValues<ValueRange>,
+					SharedValues<ColorAnimation>> values{
+						std::make_shared<const std::vector<Color>>(),
+						std::make_shared<const std::vector<double>>(),
+						std::make_shared<const std::vector<int32>>(),
+						std::make_shared<const std::vector<bool>>(),
+						std::make_shared<const std::vector<Vec2>>(),
+						std::make_shared<const std::vector<ValueRange>>(),
+						std::make_shared<const std::vector<ColorAnimation>>() };
+				//名前からハンドルへの対応(登録が無ければ前の複製と共有する)
+				std::shared_ptr<const IndexTable> indices = std::make_shared<const IndexTable>();
+			};
+
+			//スレッドごとに保持する複製の参照
+			struct ThreadCache
+			{
+				uint64 epoch = std::numeric_limits<uint64>::max();
+				std::shared_ptr<const ValueSnapshot> snapshot;
+			};
+
+			//最初の pmt::Register / pmt::Get で作られるので、ここではスレッドを起こすだけにする
+			//ファイルの用意と保存された値の読み込みは通信スレッドで行い、読み込んだ値が Update() で反映されるまでは既定値を返す
+			ParameterEditor()
+			{
+				worker1 = std::thread(ReportNewColors);
+			}
+
+			//ディレクトリとファイルを用意して保存された値を読み込む(通信スレッドの最初に 1 回だけ)
+			void initialize()
+			{
+				const String directoryName = U"ParameterEditor";
+				if (!FileSystem::Exists(directoryName))
+				{
+					FileSystem::CreateDirectories(directoryName);
+				}
+
+				{
+					const String versionFileName = directoryName + U"/version.dat";
+					const String saveFileName = directoryName + U"/save.dat";
+					if (FileSystem::Exists(versionFileName))
+					{
+						Deserializer<BinaryReader> versionDeserializer(versionFileName);
+
+						unsigned version;
+						versionDeserializer(version);
+
+						if (version == EditorVersion)
+						{
+							phase = Ready;
+
+							//データの復元はサーバー非依存に行える必要があるので初期化時にクライアントでも開く
+							//save.dat が空でも journal.dat に変更が残っている場合がある
+							if (!FileSystem::Exists(saveFileName))
+							{
+								BinaryWriter writer(saveFileName);
+							}
+
+							//クライアントが使うのは値だけなので、グループの配置などは読まない
+							ReceivedBatch loadedBatch;
+							SaveJournal::LoadValues(directoryName + U"/", loadedBatch.values);
+							if (!loadedBatch.values.empty())
+							{
+								publishBatch(std::move(loadedBatch));
+							}
+						}
+					}
+					else
+					{
+						Serializer<BinaryWriter> serializer(versionFileName);
+						serializer(EditorVersion);
+						phase = Ready;
+
+						if (FileSystem::Exists(saveFileName))
+						{
+							phase = Beginning;
+						}
+						else
+						{
+							BinaryWriter writer(saveFileName);
+						}
+					}
+				}
+
+				//ここ以降での phase == Beginning はエラー状態として扱う
+
+				if (PMT_RELEASE_FLAG)
+				{
+					phase = Beginning;
+					return;
+				}
+
+				//同じディレクトリを使うゲームを同時に起動しても通信用のファイルが重ならないように、クライアントごとのディレクトリに置く
+				const auto path = FileSystem::FullPath(directoryName);
+				const uint64 clientID = NewClientID();
+				directoryPath = path;
+				clientDirectoryPath = ClientDirectoryPath(directoryPath, clientID);
+				FileSystem::CreateDirectories(clientDirectoryPath);
+
+				{
+					Serializer<BinaryWriter> serializer(clientDirectoryPath + U"send.dat");
+					//phase が Ready になってない時は version.dat と EditorVersion が一致しない可能性がある
+					//サーバー側でクライアントの EditorVersion を把握するため送っておく
+					serializer(EditorVersion);
+				}
+				{
+					BinaryWriter writer(clientDirectoryPath + U"receive.dat");
+				}
+
+				channel.setFiles(clientDirectoryPath, clientDirectoryPath + U"send.dat", clientDirectoryPath + U"receive.dat");
+
+				std::array<char32_t, 256> filePath{};
+				for (auto ic : Indexed(path))
+				{
+					filePath[ic.first] = ic.second;
+				}
+
+				Serializer<MemoryWriter> serializer;
+				serializer(filePath);
+				serializer(clientID);
+				const auto& writer = serializer.getWriter();
+				sendData = ByteArray(writer.data(), static_cast<size_t>(writer.size()));
+
+				//リングバッファのファイルはサーバーと接続する前に用意しておく
+				//サーバーはハンドシェイク時にファイルがあればリングバッファを使う
+				if (PMT_SHARED_MEMORY_FLAG)
+				{
+					const FilePath sendRingPath = clientDirectoryPath + U"send.ring";
+					const FilePath receiveRingPath = clientDirectoryPath + U"receive.ring";
+					SharedRingBuffer::Create(sendRingPath);
+					SharedRingBuffer::Create(receiveRingPath);
+					channel.openRings(sendRingPath, receiveRingPath);
+				}
+			}
+
+			//新しく追加された色をサーバーに送る
+			static void ReportNewColors()
+			{
+				auto& i = instance();
+				i.initialize();
+				if (PMT_RELEASE_FLAG)
+				{
+					return;
+				}
+
+				i.client.connect(IPv4::localhost(), PortNumber);
+				bool failureReported = false;
+
+				while (i.signal.wait())
+				{
+					switch (i.phase)
+					{
+					case ParameterEditor::Beginning:
+					{
+						if (!failureReported)
+						{
+							ReportStatus(U"初期化に失敗");
+							failureReported = true;
+						}
+						break;
+					}
+					case ParameterEditor::Ready:
+					{
+						if (i.client.isConnected())
+						{
+							//Window::SetTitle(U"TCPClient: 接続完了！");
+
+							i.client.send(i.sendData.data(), HandshakeSize);
+							i.sendData = ByteArray();
+							i.phase = WaitingServer;
+
+							break;
+						}
+
+						if (i.client.hasError())
+						{
+							i.client.disconnect();
+							//Window::SetTitle(U"TCPClient: 再接続待機中...");
+							i.client.connect(IPv4::localhost(), PortNumber);
+						}
+
+						break;
+					}
+					case ParameterEditor::WaitingServer:
+					{
+						const FilePath receiveFilePath = i.clientDirectoryPath + U"receive.dat";
+						const FilePath sendFilePath = i.clientDirectoryPath + U"send.dat";
+
+						/*
+						メインスレッドの方がこっちのスレッドより多く回る可能性がある
+						->DirectoryWatcherが捕捉を漏らす可能性がある？あるとしたらここでは使うべきでない
+
+						クライアント側では、send.dat にバージョン情報を書き込んだ後に通信を始める
+						サーバー側では、receive.dat にバージョン情報を書き込んだ後に send.dat の中身をクリアする
+						したがって、ここで send.dat の中身が空だった時は、確実に receive.dat には有効な値が入っているはず
+						*/
+
+						if (FileSystem::IsEmpty(sendFilePath))
+						{
+							{
+								Deserializer<BinaryReader> deserializer(receiveFilePath);
+
+								unsigned version;
+								deserializer(version);
+
+								if (version != EditorVersion)
+								{
+									i.phase = Beginning;
+								}
+								else
+								{
+									//以降の通信もこの接続を使い続ける
+									i.phase = Running;
+								}
+
+							}
+
+							BinaryWriter writer(receiveFilePath);
+						}
+
+						break;
+					}
+					case ParameterEditor::Running:
+					{
+						if (i.client.isConnected() && i.client.hasError())
+						{
+							i.client.disconnect();
+						}
+
+						ReceivedBatch receivedBatch;
+						const auto receive = [&](const ParameterMessage& message)
+						{
+							i.decoder.decode(message, receivedBatch.values);
+
+							//計測付きのメッセージは最初の値を代表として追跡する
+							const auto parameter = i.decoder.getFirstParameter(message);
+							if (message.editedAt != 0 && parameter)
+							{
+								PendingTrace pending;
+								pending.trace.editedAt = message.editedAt;
+								pending.trace.sentAt = message.sentAt;
+								pending.trace.receivedAt = TraceClock();
+								pending.type = parameter.value().first;
+								pending.name = parameter.value().second;
+								receivedBatch.traces.push_back(std::move(pending));
+							}
+						};
+
+						i.channel.receive(ClientSocket{ i.client }, receive);
+
+						if (!receivedBatch.values.empty() || !receivedBatch.traces.empty())
+						{
+							i.publishBatch(std::move(receivedBatch));
+						}
+
+						if (!i.pendingMessage)
+						{
+							std::lock_guard<std::mutex> lock(i.mtx);
+							if (!i.data1.empty() || !i.completedTraces.empty())
+							{
+								i.pendingMessage = i.encoder.encode(i.data1);
+								i.pendingMessage.value().latencies = std::move(i.completedTraces);
+								i.data1 = ParameterData();
+								i.completedTraces.clear();
+							}
+						}
+
+						i.channel.flush();
+						if (i.pendingMessage && i.channel.send(ClientSocket{ i.client }, i.pendingMessage.value()))
+						{
+							i.pendingMessage = none;
+						}
+
+						break;
+					}
+					default: break;
+					}
+				}
+			}
+
+			template <class Type>
+			ParameterStorage<Type>& getStorage()
+			{
+				return std::get<ParameterStorage<Type>>(storages);
+			}
+
+			//呼び出したスレッドの複製を返す(エポックが進んでいれば取り直す)
+			const ValueSnapshot& getSnapshot()
+			{
+				thread_local ThreadCache cache;
+				if (cache.epoch != epoch.load(std::memory_order_acquire))
+				{
+					cache.snapshot = std::atomic_load(&snapshot);
+					cache.epoch = cache.snapshot->epoch;
+				}
+				return *cache.snapshot;
+			}
+
+			//storages の内容を新しい複製として公開してエポックを進める(registryMutex を取った状態で呼ぶ)
+			void publishSnapshot()
+			{
+				auto next = std::make_shared<ValueSnapshot>();
+				next->epoch = ++publishedEpoch;
+
+				if (registeredSinceSnapshot || !publishedIndices)
+				{
+					auto indices = std::make_shared<IndexTable>();
+					ForEachParameterType([&](auto tag)
+					{
+						using Type = typename decltype(tag)::type;
+						(*indices)[ParameterTraits<Type>::Index] = getStorage<Type>().indices;
+					});
+					publishedIndices = std::move(indices);
+					registeredSinceSnapshot = false;
+				}
+				next->indices = publishedIndices;
+
+				//変更の無かった型は前の複製の配列をそのまま使う
+				const std::shared_ptr<const ValueSnapshot> previous = std::atomic_load(&snapshot);
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					constexpr size_t Index = ParameterTraits<Type>::Index;
+					std::get<Index>(next->values) = changedTypes[Index]
+						? std::make_shared<const std::vector<Type>>(getStorage<Type>().values)
+						: std::get<Index>(previous->values);
+				});
+				changedTypes.fill(false);
+
+				std::atomic_store(&snapshot, std::shared_ptr<const ValueSnapshot>(std::move(next)));
+				epoch.store(publishedEpoch, std::memory_order_release);
+				snapshotDirty = false;
+			}
+
+			//未登録の名前を登録してサーバーに通知する(registryMutex を取った状態で呼ぶ)
+			template <class Type>
+			uint32 registerValue(const String& name, const Type& value)
+			{
+				auto& storage = getStorage<Type>();
+				const uint32 index = static_cast<uint32>(storage.values.size());
+				storage.indices.emplace(name, index);
+				storage.values.push_back(value);
+				tree.insert(name, ParameterTraits<Type>::Kind, index);
+				registeredSinceSnapshot = true;
+				changedTypes[ParameterTraits<Type>::Index] = true;
+				snapshotDirty = true;
+
+				std::lock_guard<std::mutex> lock(mtx);
+				data1.get<Type>()[name] = value;
+
+				return index;
+			}
+
+			//サーバーから受け取った値を反映する(こちらは通知しない, registryMutex を取った状態で呼ぶ)
+			template <class Type>
+			void setValue(const String& name, const Type& value)
+			{
+				auto& storage = getStorage<Type>();
+				changedTypes[ParameterTraits<Type>::Index] = true;
+				const auto it = storage.indices.find(name);
+				if (it != storage.indices.end())
+				{
+					storage.values[it->second] = value;
+					return;
+				}
+
+				const uint32 index = static_cast<uint32>(storage.values.size());
+				storage.indices.emplace(name, index);
+				storage.values.push_back(value);
+				tree.insert(name, ParameterTraits<Type>::Kind, index);
+				registeredSinceSnapshot = true;
+			}
+
+			void setValues(const ParameterData& data)
+			{
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					if constexpr (std::is_same_v<Type, Color>)
+					{
+						//エディタから届く ColorF はまとめて変換してから反映する
+						std::vector<const String*> names;
+						std::vector<ColorF> sources;
+						names.reserve(data.colors.size());
+						sources.reserve(data.colors.size());
+						for (const auto& keyVal : data.colors)
+						{
+							names.push_back(&keyVal.first);
+							sources.push_back(keyVal.second);
+						}
+
+						std::vector<Color> colors(sources.size());
+						ConvertColors(sources.data(), colors.data(), sources.size());
+						for (size_t n = 0; n < colors.size(); ++n)
+						{
+							setValue<Color>(*names[n], colors[n]);
+						}
+					}
+					else
+					{
+						for (const auto& keyVal : data.get<Type>())
+						{
+							setValue<Type>(keyVal.first, Type(keyVal.second));
+						}
+					}
+				});
+			}
+
+			//変更された名前ごとに、根からその名前までの節の購読を集める(名前の深さに比例する, registryMutex を取った状態で呼ぶ)
+			void collectNotifications(const ParameterData& data, std::vector<std::pair<ChangeHandler, String>>& notifications)const
+			{
+				if (subscriptions.empty())
+				{
+					return;
+				}
+
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					for (const auto& keyVal : data.get<Type>())
+					{
+						tree.forEachOnPath(keyVal.first, [&](uint32 node)
+						{
+							for (const uint32 id : tree.getNode(node).subscriptions)
+							{
+								notifications.emplace_back(subscriptions.find(id)->second.handler, keyVal.first);
+							}
+						});
+					}
+				});
+			}
+
+			//受信した変更をメインスレッドへ公開する(ワーカースレッド専用)
+			//前回分がまだ取り込まれていなければ統合してから公開し直す
+			void publishBatch(ReceivedBatch&& batch)
+			{
+				std::unique_ptr<ReceivedBatch> next = std::make_unique<ReceivedBatch>(std::move(batch));
+
+				std::unique_ptr<ReceivedBatch> previous(publishedBatch.exchange(nullptr));
+				if (previous)
+				{
+					previous->values.merge(next->values);
+					previous->traces.insert(previous->traces.end(), next->traces.begin(), next->traces.end());
+					next = std::move(previous);
+				}
+
+				publishedBatch.store(next.release());
+			}
+
+			//計測中の名前を型とハンドルに直しておく(読む側は名前を引かずにハンドルだけを比べる, registryMutex を取った状態で呼ぶ)
+			void resolveReadTrace()
+			{
+				uint8 type = NoTracedType;
+				uint32 index = 0;
+				if (readTrace)
+				{
+					ForEachParameterType([&](auto tag)
+					{
+						using Type = typename decltype(tag)::type;
+						if (ParameterTraits<Type>::Kind != readTrace.value().type)
+						{
+							return;
+						}
+
+						const auto& storage = getStorage<Type>();
+						const auto it = storage.indices.find(readTrace.value().name);
+						if (it != storage.indices.end())
+						{
+							type = static_cast<uint8>(ParameterTraits<Type>::Kind);
+							index = it->second;
+						}
+					});
+				}
+
+				tracedIndex.store(index, std::memory_order_relaxed);
+				tracedType.store(type, std::memory_order_relaxed);
+				tracing.store(type != NoTracedType, std::memory_order_release);
+			}
+
+			//計測中の値が読まれたら計測を終えてエディタへ返す
+			//計測するのはゲームのメインスレッド(Update() を呼ぶスレッド)で読まれた時だけ
+			//計測中のハンドルと一致した時だけロックを取る
+			template <class Type>
+			void traceRead(uint32 index)
+			{
+				if (tracedType.load(std::memory_order_relaxed) != static_cast<uint8>(ParameterTraits<Type>::Kind)
+					|| tracedIndex.load(std::memory_order_relaxed) != index)
+				{
+					return;
+				}
+
+				std::lock_guard<std::mutex> lock(registryMutex);
+				if (!readTrace || std::this_thread::get_id() != mainThreadId
+					|| tracedType.load(std::memory_order_relaxed) != static_cast<uint8>(ParameterTraits<Type>::Kind)
+					|| tracedIndex.load(std::memory_order_relaxed) != index)
+				{
+					return;
+				}
+
+				auto& pending = readTrace.value();
+				pending.trace.readAt = TraceClock();
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					completedTraces.push_back(pending.trace);
+				}
+				readTrace = none;
+				resolveReadTrace();
+			}
+
+			ParameterEditor(const ParameterEditor&) = delete;
+
+			~ParameterEditor()
+			{
+				terminateAllThreads();
+				delete publishedBatch.exchange(nullptr);
+
+				//エディタ側も同じファイルをマップしているので、先に切断してエディタに閉じてもらう
+				//エディタがまだ閉じていなければここでは消せないが、その場合はエディタが切断を見つけた時に消す
+				client.disconnect();
+				channel = MessageChannel();
+				if (!clientDirectoryPath.isEmpty())
+				{
+					FileSystem::Remove(clientDirectoryPath);
+				}
+			}
+
+			static ParameterEditor& instance()
+			{
+				static ParameterEditor obj;
+				return obj;
+			}
+
+			void terminateAllThreads()
+			{
+				signal.terminate();
+				if (worker1.joinable())
+				{
+					worker1.join();
+				}
+			}
+
+			enum Phase { Beginning, Ready, WaitingServer, Running };
+			//Beginning     初期状態(or初期化に失敗)
+			//Ready         クライアントとセーブデータのバージョン番号の一致を確認(通信待機状態)
+			//WaitingServer ディレクトリ情報の送信完了(receive.datの更新待機状態)
+			//Running       クライアントとサーバーのバージョン番号の一致を確認(通常状態)
+			//              リングバッファ(send.ring / receive.ring) > TCP 接続 > send.dat / receive.dat の優先順で通信する
+
+			TCPClient client;
+			uint32 receivedVal = 0;
+			//登録・受信した値の反映と計測の状態を保護する(mtx より先に取る)
+			std::mutex registryMutex;
+			//型ごとの値の実体と名前からハンドルへの対応(registryMutex で保護)
+			std::tuple<
+				ParameterStorage<Color>,
+				ParameterStorage<double>,
+				ParameterStorage<int32>,
+				ParameterStorage<bool>,
+				ParameterStorage<Vec2>,
+				ParameterStorage<ValueRange>,
+				ParameterStorage<ColorAnimation>> storages;
+			//ワーカーからメインスレッドへ受け渡す未反映の変更
+			std::atomic<ReceivedBatch*> publishedBatch{ nullptr };
+			//読み取り用に公開した複製とその世代(snapshot は atomic_load / atomic_store でだけ触る)
+			std::shared_ptr<const ValueSnapshot> snapshot = std::make_shared<const ValueSnapshot>();
+			std::atomic<uint64> epoch{ 0 };
+			//ここから下の 5 つは registryMutex で保護(changedTypes は前の複製から値が変わった型)
+			uint64 publishedEpoch = 0;
+			std::shared_ptr<const IndexTable> publishedIndices;
+			bool registeredSinceSnapshot = false;
+			std::array<bool, ParameterTypeCount> changedTypes{};
+			bool snapshotDirty = false;
+			//階層付きの名前の索引と、前方一致の購読(registryMutex で保護)
+			ParameterTree tree;
+			std::unordered_map<uint32, Subscription> subscriptions;
+			uint32 lastSubscriptionID = 0;
+			//反映済みでまだ読まれていない計測と、届いてから経った Update() の回数(registryMutex で保護)
+			Optional<PendingTrace> readTrace;
+			uint32 readTraceAge = 0;
+			std::thread::id mainThreadId;
+			//readTrace を型とハンドルに直したもの(ロックを取らずに読む, 計測が無ければ tracedType は NoTracedType)
+			std::atomic<bool> tracing{ false };
+			std::atomic<uint8> tracedType{ NoTracedType };
+			std::atomic<uint32> tracedIndex{ 0 };
+			//アニメーションの評価と、並べ直した時の値の配列(animationSource は Animate を呼ぶスレッド専用)
+			AnimationEvaluator animations;
+			SharedValues<ColorAnimation> animationSource;
+			//サーバーへ通知する新しいパラメータと計測し終えた変更(mtx で保護)
+			ParameterData data1;
+			Array<LatencyTrace> completedTraces;
+			ParameterEncoder encoder;
+			ParameterDecoder decoder;
+			Optional<ParameterMessage> pendingMessage;
+
+			ByteArray sendData;
+			String directoryPath;
+			String clientDirectoryPath;
+			MessageChannel channel;
+
+			std::thread worker1;
+			std::mutex mtx;
+
+			WorkerSignal signal;
+
+			Phase phase = Beginning;
+		};
+	}
+}
+
+#ifdef PMT_BAKED_HEADER
+#include PMT_BAKED_HEADER
+
+namespace pmt
+{
+	namespace detailImpl
+	{
+		template <class Type>
+		constexpr const auto& BakedEntries()
+		{
+			if constexpr (ParameterTraits<Type>::Index == 0) { return baked::Colors; }
+			else if constexpr (ParameterTraits<Type>::Index == 1) { return baked::Floats; }
+			else if constexpr (ParameterTraits<Type>::Index == 2) { return baked::Ints; }
+			else if constexpr (ParameterTraits<Type>::Index == 3) { return baked::Bools; }
+			else if constexpr (ParameterTraits<Type>::Index == 4) { return baked::Vec2s; }
+			else if constexpr (ParameterTraits<Type>::Index == 5) { return baked::Ranges; }
+			else { return baked::Animations; }
+		}
+
+		//焼き込まれた値を API の型に戻す(ColorAnimation 以外はそのまま)
+		template <class Type>
+		constexpr const Type& FromBaked(const Type& value)
+		{
+			return value;
+		}
+
+		inline ColorAnimation FromBaked(const BakedAnimation& baked)
+		{
+			ColorAnimation animation;
+			animation.duration = baked.duration;
+			animation.loop = baked.loop;
+			for (uint32 n = 0; n < baked.keyCount; ++n)
+			{
+				const BakedKeyframe& key = baked::AnimationKeys[baked.firstKey + n];
+				animation.keys.push_back({ key.time, ColorF(key.r, key.g, key.b, key.a), key.easing });
+			}
+			return animation;
+		}
+
+		constexpr int32 CompareBakedName(const char32_t* a, const char32_t* b)
+		{
+			while (*a != 0 && *a == *b)
+			{
+				++a;
+				++b;
+			}
+			return *a < *b ? -1 : (*b < *a ? 1 : 0);
+		}
+
+		//焼き込まれた値の添字を二分探索で求める(見つからなければ配列の大きさ)
+		template <class Type>
+		constexpr size_t FindBakedIndex(const char32_t* name)
+		{
+			const auto& entries = BakedEntries<Type>();
+			size_t first = 0;
+			size_t last = entries.size();
+			while (first < last)
+			{
+				const size_t middle = first + (last - first) / 2;
+				const int32 order = CompareBakedName(entries[middle].name, name);
+				if (order == 0)
+				{
+					return middle;
+				}
+
+				if (order < 0)
+				{
+					first = middle + 1;
+				}
+				else
+				{
+					last = middle;
+				}
+			}
+			return entries.size();
+		}
+
+		//PMT_BAKED_HEADER を定義した時に ParameterEditor の代わりに使う
+		//ディレクトリも通信スレッドも作らず、焼き込まれた値を添字で返すだけ
+		class BakedParameterEditor
+		{
+		public:
+			static void Update() {}
+
+			static void SetTickRate(double) {}
+
+			template <class Type>
+			static Param<Type> Register(const String& name, const Optional<Type>& defaultValue)
+			{
+				const size_t index = FindBakedIndex<Type>(name.c_str());
+				if (index < BakedEntries<Type>().size())
+				{
+					return Param<Type>(static_cast<uint32>(index));
+				}
+
+				//書き出した後に追加された名前は、焼き込まれた値の後ろに既定値で登録する
+				auto& i = instance();
+				std::lock_guard<std::mutex> lock(i.mtx);
+				auto& storage = std::get<ParameterStorage<Type>>(i.storages);
+				const auto it = storage.indices.find(name);
+				if (it != storage.indices.end())
+				{
+					return Param<Type>(static_cast<uint32>(BakedEntries<Type>().size() + it->second));
+				}
+
+				ReportStatus(U"書き出されていないパラメータ: {}"_fmt(name));
+				const uint32 fallbackIndex = static_cast<uint32>(storage.values.size());
+				storage.indices.emplace(name, fallbackIndex);
+				storage.values.push_back(defaultValue ? defaultValue.value() : ParameterTraits<Type>::Default());
+				const uint32 index = static_cast<uint32>(BakedEntries<Type>().size() + fallbackIndex);
+				if (i.treeBuilt)
+				{
+					i.tree.insert(name, ParameterTraits<Type>::Kind, index);
+				}
+				return Param<Type>(index);
+			}
+
+			template <class Type>
+			static Type Get(const Param<Type>& param)
+			{
+				const auto& entries = BakedEntries<Type>();
+				if (param.index < entries.size())
+				{
+					return FromBaked(entries[param.index].value);
+				}
+
+				auto& i = instance();
+				std::lock_guard<std::mutex> lock(i.mtx);
+				return std::get<ParameterStorage<Type>>(i.storages).values[param.index - entries.size()];
+			}
+
+			template <class Output>
+			static void GetColors(const Param<Color>* params, size_t count, Output* results)
+			{
+				GatherColors(params, count, results, [](const Param<Color>* blockParams, size_t blockCount, Color* colors)
+				{
+					for (size_t n = 0; n < blockCount; ++n)
+					{
+						colors[n] = Get(blockParams[n]);
+					}
+				});
+			}
+
+			//焼き込まれたアニメーションは変わらないので、並べ直すのは最初の 1 回だけ
+			static void Animate(double time)
+			{
+				auto& i = instance();
+				if (!i.animationsBuilt)
+				{
+					std::vector<ColorAnimation> animations;
+					for (const auto& entry : BakedEntries<ColorAnimation>())
+					{
+						animations.push_back(FromBaked(entry.value));
+					}
+					i.animations.build(animations);
+					i.animationsBuilt = true;
+				}
+				i.animations.evaluate(time);
+			}
+
+			static Color GetAnimated(const Param<ColorAnimation>& param)
+			{
+				auto& i = instance();
+				const auto& colors = i.animations.current();
+				if (param.index < colors.size())
+				{
+					return colors[param.index];
+				}
+				return AnimationEvaluator::Evaluate(Get(param), i.animations.getTime());
+			}
+
+			//索引は最初に列挙された時に作る
+			static Array<String> List(const String& prefix)
+			{
+				auto& i = instance();
+				std::lock_guard<std::mutex> lock(i.mtx);
+				i.buildTree();
+				return i.tree.list(prefix);
+			}
+
+			//焼き込まれた値は変わらないので、handler が呼ばれることはない
+			static uint32 Subscribe(const String&, const ChangeHandler&)
+			{
+				auto& i = instance();
+				std::lock_guard<std::mutex> lock(i.mtx);
+				return ++i.lastSubscriptionID;
+			}
+
+			static void Unsubscribe(uint32) {}
+
+		private:
+			BakedParameterEditor() = default;
+
+			BakedParameterEditor(const BakedParameterEditor&) = delete;
+
+			static BakedParameterEditor& instance()
+			{
+				static BakedParameterEditor obj;
+				return obj;
+			}
+
+			//焼き込まれていない名前の値(mtx で保護)
+			std::mutex mtx;
+			std::tuple<
+				ParameterStorage<Color>,
+				ParameterStorage<double>,
+				ParameterStorage<int32>,
+				ParameterStorage<bool>,
+				ParameterStorage<Vec2>,
+				ParameterStorage<ValueRange>,
+				ParameterStorage<ColorAnimation>> storages;
+
+			//焼き込まれた名前と焼き込まれていない名前をまとめた索引(mtx で保護)
+			void buildTree()
+			{
+				if (treeBuilt)
+				{
+					return;
+				}
+
+				ForEachParameterType([&](auto tag)
+				{
+					using Type = typename decltype(tag)::type;
+					const auto& entries = BakedEntries<Type>();
+					for (size_t index = 0; index < entries.size(); ++index)
+					{
+						tree.insert(entries[index].name, ParameterTraits<Type>::Kind, static_cast<uint32>(index));
+					}
+					for (const auto& keyVal : std::get<ParameterStorage<Type>>(storages).indices)
+					{
+						tree.insert(keyVal.first, ParameterTraits<Type>::Kind, static_cast<uint32>(entries.size() + keyVal.second));
+					}
+				});
+				treeBuilt = true;
+			}
+
+			ParameterTree tree;
+			bool treeBuilt = false;
+			uint32 lastSubscriptionID = 0;
+
+			AnimationEvaluator animations;
+			bool animationsBuilt = false;
+		};
+
+		using ActiveParameterEditor = BakedParameterEditor;
+	}
+}
+#else
+namespace pmt
+{
+	namespace detailImpl
+	{
+		using ActiveParameterEditor = ParameterEditor;
+	}
+}
+#endif
+
+namespace pmt
+{
+	inline void Update()
+	{
+		detailImpl::ActiveParameterEditor::Update();
+	}
+
+	//通信スレッドが 1 秒間に回る最大回数を設定する
+	inline void SetTickRate(double tickRate)
+	{
+		detailImpl::ActiveParameterEditor::SetTickRate(tickRate);
+	}
+
+	//初期化に失敗した時などの状態の通知先を設定する(通信スレッドから呼ばれる)
+	inline void SetStatusHandler(const detailImpl::StatusHandler& handler)
+	{
+		detailImpl::GetStatusHandler() = handler;
+	}
+
+	using detailImpl::Param;
+	using detailImpl::ColorParam;
+	using detailImpl::FloatParam;
+	using detailImpl::IntParam;
+	using detailImpl::BoolParam;
+	using detailImpl::Vec2Param;
+	using detailImpl::RangeParam;
+	using detailImpl::AnimatedColorParam;
+
+	//名前を一度だけ解決してハンドルを得る
+	//Type は Color, double, int32, bool, Vec2, ValueRange, ColorAnimation のいずれか
+	template <class Type = Color>
+	inline Param<Type> Register(const String& name)
+	{
+		return detailImpl::ActiveParameterEditor::Register<Type>(name, none);
+	}
+
+	//defaultValue は初めて登録される時の値
+	template <class Type>
+	inline Param<Type> Register(const String& name, const Type& defaultValue)
+	{
+		return detailImpl::ActiveParameterEditor::Register<Type>(name, defaultValue);
+	}
+
+	template <class Type>
+	inline Type GetValue(const Param<Type>& param)
+	{
+		return detailImpl::ActiveParameterEditor::Get(param);
+	}
+
+	inline Color GetColor(const ColorParam& param)
+	{
+		return GetValue(param);
+	}
+
+	inline Color GetColor(const String& name)
+	{
+		return GetColor(Register(name));
+	}
+
+	//count 個のハンドルの色を results にまとめて書き出す(インスタンス描画の色の転送など)
+	inline void GetColors(const ColorParam* params, size_t count, Color* results)
+	{
+		detailImpl::ActiveParameterEditor::GetColors(params, count, results);
+	}
+
+	inline void GetColors(const ColorParam* params, size_t count, ColorF* results)
+	{
+		detailImpl::ActiveParameterEditor::GetColors(params, count, results);
+	}
+
+	inline double GetFloat(const FloatParam& param)
+	{
+		return GetValue(param);
+	}
+
+	inline double GetFloat(const String& name, double defaultValue = 0.0)
+	{
+		return GetFloat(Register(name, defaultValue));
+	}
+
+	inline int32 GetInt(const IntParam& param)
+	{
+		return GetValue(param);
+	}
+
+	inline int32 GetInt(const String& name, int32 defaultValue = 0)
+	{
+		return GetInt(Register(name, defaultValue));
+	}
+
+	inline bool GetBool(const BoolParam& param)
+	{
+		return GetValue(param);
+	}
+
+	inline bool GetBool(const String& name, bool defaultValue = false)
+	{
+		return GetBool(Register(name, defaultValue));
+	}
+
+	inline Vec2 GetVec2(const Vec2Param& param)
+	{
+		return GetValue(param);
+	}
+
+	inline Vec2 GetVec2(const String& name, const Vec2& defaultValue = Vec2(0.0, 0.0))
+	{
+		return GetVec2(Register(name, defaultValue));
+	}
+
+	inline ValueRange GetRange(const RangeParam& param)
+	{
+		return GetValue(param);
+	}
+
+	inline ValueRange GetRange(const String& name, const ValueRange& defaultValue = ValueRange())
+	{
+		return GetRange(Register(name, defaultValue));
+	}
+
+	//アニメーションする色を time 秒の時点でまとめて評価する
+	//1 フレームに 1 回、pmt::Update の後に同じスレッドで呼ぶ(以降の pmt::GetAnimatedColor は求めた色を読むだけ)
+	inline void Animate(double time)
+	{
+		detailImpl::ActiveParameterEditor::Animate(time);
+	}
+
+	inline Color GetAnimatedColor(const AnimatedColorParam& param)
+	{
+		return detailImpl::ActiveParameterEditor::GetAnimated(param);
+	}
+
+	inline Color GetAnimatedColor(const String& name)
+	{
+		return GetAnimatedColor(Register<ColorAnimation>(name));
+	}
+
+	//名前は '/' で区切って階層にできる(例: "player/body/tint")
+	//prefix 以下の名前を返す(前方一致は区切り単位, 空文字列ならすべて)
+	inline Array<String> ListParameters(const String& prefix = U"")
+	{
+		return detailImpl::ActiveParameterEditor::List(prefix);
+	}
+
+	//prefix 以下の値がエディタから変更されたら pmt::Update の中で handler(name) を呼ぶ
+	//戻り値は pmt::Unsubscribe に渡す ID
+	inline uint32 Subscribe(const String& prefix, const detailImpl::ChangeHandler& handler)
+	{
+		return detailImpl::ActiveParameterEditor::Subscribe(prefix, handler);
+	}
+
+	inline void Unsubscribe(uint32 subscriptionID)
+	{
+		detailImpl::ActiveParameterEditor::Unsubscribe(subscriptionID);
+	}
+}
+
+//呼び出し箇所ごとに一度だけ登録し、以降はハンドルで値を引く
+//例: PMT_COLOR("Background"), PMT_FLOAT("PlayerSpeed")
+#ifdef PMT_BAKED_HEADER
+//名前はコンパイル時に解決する(書き出されていない名前だけ実行時に登録する)
+#define PMT_PARAM(Type, name) ([]() -> Type { constexpr auto index = ::pmt::detailImpl::FindBakedIndex<Type>(U"" name); if constexpr (index < ::pmt::detailImpl::BakedEntries<Type>().size()) { return ::pmt::detailImpl::FromBaked(::pmt::detailImpl::BakedEntries<Type>()[index].value); } else { static const ::pmt::Param<Type> param = ::pmt::Register<Type>(U"" name); return ::pmt::GetValue(param); } }())
+#else
+#define PMT_PARAM(Type, name) (::pmt::GetValue([]() -> ::pmt::Param<Type> { static const ::pmt::Param<Type> param = ::pmt::Register<Type>(U"" name); return param; }()))
+#endif
+#define PMT_COLOR(name) PMT_PARAM(::s3d::Color, name)
+#define PMT_FLOAT(name) PMT_PARAM(double, name)
+#define PMT_INT(name) PMT_PARAM(::s3d::int32, name)
+#define PMT_BOOL(name) PMT_PARAM(bool, name)
+#define PMT_VEC2(name) PMT_PARAM(::s3d::Vec2, name)
+#define PMT_RANGE(name) PMT_PARAM(::pmt::ValueRange, name)
+#define PMT_ANIMATED_COLOR(name) (::pmt::GetAnimatedColor([]() -> ::pmt::AnimatedColorParam { static const ::pmt::AnimatedColorParam param = ::pmt::Register<::pmt::ColorAnimation>(U"" name); return param; }()))